@@ -0,0 +1,71 @@
+#pragma once
+
+// Field access by name for dynamic callers such as script bindings. A
+// field_handle looks the name up once per type it sees and caches the
+// result, so repeated accesses from one call site cost a compare of the type
+// id and an add:
+//
+//     void* health = PRX_FIELD("health").get(id, object);
+//     if (health)
+//         *(int*)health = 100;
+//
+// A handle whose cached type differs from the object's looks the field up
+// again in the registry and caches that instead, so a call site that sees
+// alternating types keeps missing. The lookup is the registry's perfect hash
+// over the type's own fields; fields of bases aren't found. A handle isn't
+// synchronized. PRX_FIELD keeps one per thread and call site.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <prx/Registry.h>
+
+namespace prx {
+
+class field_handle {
+public:
+    // Constant, so a static handle needs no initialization guard; the
+    // registry is only looked at on the first miss
+    constexpr explicit field_handle(const char* name, const registry* types = 0)
+        : types_(types), name_(name), type_(invalid_type_id), offset_(missing), field_type_(invalid_type_id) {}
+
+    // The field in object, which is of type type; null when the type has no
+    // field of that name
+    void* get(type_id type, void* object) {
+        if (type != type_)
+            resolve(type);
+        return offset_ == missing ? 0 : static_cast<char*>(object) + offset_;
+    }
+    const void* get(type_id type, const void* object) { return get(type, const_cast<void*>(object)); }
+    // By the object's static type; a const object takes the type's own id
+    template <typename T> void* get(T& object) { return get(reflect<T>::id, static_cast<void*>(&object)); }
+    template <typename T> const void* get(const T& object) { return get(reflect<T>::id, static_cast<const void*>(&object)); }
+
+    // Of the last type get was called with: the field's type, when it is
+    // reflected
+    type_id field_type() const { return field_type_; }
+    const char* name() const { return name_; }
+
+private:
+    static constexpr uint32_t missing = 0xffffffffu;
+
+    void resolve(type_id type) {
+        if (!types_)
+            types_ = &registry::generated();
+        const field_record* field = types_->find_field(type, name_);
+        type_ = type;
+        offset_ = field ? field->offset : missing;
+        field_type_ = field ? field->type : invalid_type_id;
+    }
+
+    const registry* types_;
+    const char* name_;
+    type_id type_;
+    uint32_t offset_;
+    type_id field_type_;
+};
+
+} // namespace prx
+
+// A handle for the field name, cached at the call site
+#define PRX_FIELD(name) ([]() -> prx::field_handle& { static thread_local prx::field_handle handle(name); return handle; }())
@@ -0,0 +1,32 @@
+#pragma once
+
+// Markers the scanner looks for. They expand to clang annotate attributes only
+// while scanning (scan defines PRX_SCANNER), so regular builds with any
+// compiler never see them.
+//
+//     struct PRX_REFLECT Player {
+//         int health;
+//         float cachedDistance PRX_NOREFLECT;
+//     };
+
+#if defined(PRX_SCANNER)
+#define PRX_ANNOTATE(text) __attribute__((annotate(text)))
+#else
+#define PRX_ANNOTATE(text)
+#endif
+
+// Reflect this struct, class or enum
+#define PRX_REFLECT PRX_ANNOTATE("reflect")
+// Leave this field out of the reflected type
+#define PRX_NOREFLECT PRX_ANNOTATE("noreflect")
+// Generate a JSON reader and writer for this reflected struct or enum, see
+// prx/Json.h
+#define PRX_JSON PRX_ANNOTATE("json")
+// Generate prx::hash and prx::equal_to for this reflected struct, see
+// prx/Hash.h
+#define PRX_HASH PRX_ANNOTATE("hash")
+// Generate a prx::soa_vector for this reflected struct, see prx/Soa.h
+#define PRX_SOA PRX_ANNOTATE("soa")
+// Generate a dirty-tracking prx::tracked with delta serialization for this
+// reflected struct, see prx/Delta.h
+#define PRX_REPLICATE PRX_ANNOTATE("replicate")
@@ -0,0 +1,164 @@
+#pragma once
+
+// A value of any reflected type, held without a heap allocation when it fits.
+// Whether it fits is decided from the type's record in the registry, and
+// copies, moves and destruction go through the record's lifetime thunks
+// rather than virtual calls:
+//
+//     prx::any value = player;              // in the buffer if it fits
+//     prx::any other = value;               // through the copy thunk
+//     if (Player* p = other.get<Player>())
+//         p->health = 0;
+//     prx::any blank(types.find("game::Player")); // default constructed
+//
+// A value up to inline_size bytes, aligned to at most inline_align and
+// movable is stored in the any itself. Larger or over-aligned values, and
+// values that can't be moved, are stored on the heap. The any is a cache
+// line: the buffer, the record pointer and the type id.
+//
+// Copying an any of a type that can't be copied leaves the copy empty, as
+// does constructing one for a type that can't be default constructed.
+
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+#include <prx/Registry.h>
+
+namespace prx {
+
+class alignas(16) any {
+public:
+    static constexpr size_t inline_size = 48;
+    static constexpr size_t inline_align = 16;
+
+    any() : type_(0), id_(invalid_type_id) {}
+
+    // A default constructed value of the type
+    explicit any(type_id type, const registry& types = registry::generated()) : any() {
+        const type_record& record = types.type(type);
+        if (record.ops && record.ops->construct)
+            emplace(type, record, [&](void* at) { record.ops->construct(at, 1); });
+    }
+
+    // A copy of the object at value, which is of the type
+    any(type_id type, const void* value, const registry& types = registry::generated()) : any() {
+        const type_record& record = types.type(type);
+        if (record.ops && record.ops->copy)
+            emplace(type, record, [&](void* at) { record.ops->copy(at, value); });
+    }
+
+    // Constructed in place from value, no thunk involved. Only for types with
+    // a reflect specialization, which a type id or an any doesn't have.
+    template <typename T, typename V = typename std::decay<T>::type, typename = decltype(reflect<V>::id)>
+    any(T&& value, const registry& types = registry::generated()) : any() {
+        const type_record& record = types.type(reflect<V>::id);
+        emplace(reflect<V>::id, record, [&](void* at) { new (at) V(std::forward<T>(value)); });
+    }
+
+    any(const any& other) : any() {
+        if (other.type_ && other.type_->ops && other.type_->ops->copy)
+            emplace(other.id_, *other.type_, [&](void* at) { other.type_->ops->copy(at, other.data()); });
+    }
+    any(any&& other) : any() { take(other); }
+    any& operator=(const any& other) {
+        if (this != &other) {
+            any copy(other);
+            reset();
+            take(copy);
+        }
+        return *this;
+    }
+    any& operator=(any&& other) {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+    ~any() { reset(); }
+
+    bool empty() const { return type_ == 0; }
+    type_id type() const { return id_; }
+    const type_record* record() const { return type_; }
+    bool is_inline() const { return type_ && fits(*type_); }
+
+    void* data() { return type_ && !fits(*type_) ? heap() : buffer_; }
+    const void* data() const { return const_cast<any*>(this)->data(); }
+
+    // The value when it is a T, null otherwise
+    template <typename T> T* get() { return id_ == reflect<T>::id ? static_cast<T*>(data()) : 0; }
+    template <typename T> const T* get() const { return id_ == reflect<T>::id ? static_cast<const T*>(data()) : 0; }
+
+    void reset() {
+        if (!type_)
+            return;
+        void* value = data();
+        if (type_->ops && type_->ops->destroy)
+            type_->ops->destroy(value, 1);
+        if (!fits(*type_))
+            ::operator delete(value, std::align_val_t(type_->align));
+        type_ = 0;
+        id_ = invalid_type_id;
+    }
+
+private:
+    static bool fits(const type_record& record) {
+        return record.size <= inline_size && record.align <= inline_align && record.ops && record.ops->move;
+    }
+
+    void*& heap() { return *reinterpret_cast<void**>(buffer_); }
+
+    // Frees the heap block of a value whose construction throws
+    struct heap_guard {
+        void* block;
+        size_t align;
+        ~heap_guard() {
+            if (block)
+                ::operator delete(block, std::align_val_t(align));
+        }
+    };
+
+    // Holds the value construct makes at the address it is given, in the
+    // buffer or in a heap block when it doesn't fit. This is empty before,
+    // and stays empty when construct throws.
+    template <typename Construct> void emplace(type_id id, const type_record& record, Construct&& construct) {
+        if (fits(record)) {
+            construct(static_cast<void*>(buffer_));
+        } else {
+            void* block = ::operator new(record.size, std::align_val_t(record.align));
+            heap_guard guard = { block, record.align };
+            construct(block);
+            guard.block = 0;
+            heap() = block;
+        }
+        type_ = &record;
+        id_ = id;
+    }
+
+    // Moves other's value here, leaving other empty; this is empty before
+    void take(any& other) {
+        if (!other.type_)
+            return;
+        if (fits(*other.type_)) {
+            other.type_->ops->move(buffer_, other.buffer_);
+            if (other.type_->ops->destroy)
+                other.type_->ops->destroy(other.buffer_, 1);
+        } else {
+            heap() = other.heap();
+        }
+        type_ = other.type_;
+        id_ = other.id_;
+        other.type_ = 0;
+        other.id_ = invalid_type_id;
+    }
+
+    unsigned char buffer_[inline_size];
+    const type_record* type_;
+    type_id id_;
+};
+
+static_assert(sizeof(any) == 64, "an any is one cache line");
+
+} // namespace prx
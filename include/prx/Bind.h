@@ -0,0 +1,64 @@
+#pragma once
+
+// Resolves the linker symbols of reflected functions and variables at load
+// time. The entries come from the tables scan --generate writes, and slot i
+// of the result belongs to entry i, so an entry's index in
+// prx::generated::functions is also its index in the bound table:
+//
+//     static void* bound[...];
+//     size_t missing = prx::bind_symbols(prx::generated::functions, prx::generated::function_count, bound, "plugin.so");
+//     auto add = (int (*)(int, int))bound[addIndex];
+//
+// A null library resolves against the executable itself, which then has to
+// export its symbols (-rdynamic, or __declspec(dllexport) on Windows).
+// Methods are bound as plain functions taking the object first; that holds
+// for the Itanium ABI and for x64 Windows, not for 32-bit thiscall.
+// Entries without a symbol, and symbols the library doesn't export (inline
+// functions usually aren't), are left null.
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace prx {
+
+// Returns the number of entries that couldn't be resolved, or count when the
+// library can't be loaded. The library stays loaded.
+template <typename Entry> size_t bind_symbols(const Entry* entries, size_t count, void** table, const char* library = 0) {
+#if defined(_WIN32)
+    HMODULE module = library ? LoadLibraryA(library) : GetModuleHandleA(0);
+#else
+    void* module = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+#endif
+    size_t missing = 0;
+    for (size_t i = 0; i < count; i++) {
+        table[i] = 0;
+        const char* symbol = entries[i].symbol;
+        if (!module || !symbol) {
+            missing++;
+            continue;
+        }
+#if defined(__APPLE__)
+        // Mach-O prefixes every C symbol with an underscore, dlsym adds it back
+        if (symbol[0] == '_')
+            symbol++;
+#endif
+#if defined(_WIN32)
+        table[i] = (void*)GetProcAddress(module, symbol);
+#else
+        table[i] = dlsym(module, symbol);
+#endif
+        if (!table[i])
+            missing++;
+    }
+    return missing;
+}
+
+} // namespace prx
@@ -0,0 +1,37 @@
+#pragma once
+
+// Compile-time constants of the reflected code (constexpr variables and
+// static constexpr members), evaluated by the scanner. The file scan
+// --generate writes embeds their values as literals, so they are available
+// without including the headers that declare them.
+
+#include <stddef.h>
+#include <limits>
+
+namespace prx {
+
+enum class constant_kind {
+    int_value,
+    uint_value,
+    float_value,
+    string_value,
+};
+
+struct constant_entry {
+    // Fully qualified for free constants, Type::name for members
+    const char* name;
+    // Canonical type
+    const char* type;
+    constant_kind kind;
+    long long int_value;
+    unsigned long long uint_value;
+    double float_value;
+    const char* string_value;
+};
+
+namespace generated {
+extern const constant_entry constants[];
+extern const size_t constant_count;
+} // namespace generated
+
+} // namespace prx
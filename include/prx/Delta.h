@@ -0,0 +1,127 @@
+#pragma once
+
+// Dirty tracking and delta serialization for replicated structs. For every
+// struct tagged PRX_REPLICATE, the header scan --generate-header writes
+// specializes prx::tracked: the struct plus a bitmask with one bit per field,
+// set by the generated setters.
+//
+//     prx::tracked<Player> player;
+//     player.set_health(90);
+//     prx::delta_writer out;
+//     player.write_delta(out); // the mask, then only the health
+//     player.clear_dirty();
+//
+//     prx::delta_reader in(out.bytes.data(), out.bytes.size());
+//     remote.apply_delta(in);
+//
+// A delta is the mask in (fields + 7) / 8 bytes followed by the values of
+// the marked fields in field order. Trivially copyable values are copied as
+// their bytes, so both ends have to agree on layout and byte order.
+// std::string and std::vector are written with a length. A tracked struct
+// starts out with every field dirty, so its first delta is a full update.
+// Every field of the struct has to be public, and the struct can't have
+// bases.
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace prx {
+
+template <typename T> class tracked;
+
+struct delta_writer {
+    std::vector<unsigned char> bytes;
+
+    void write(const void* data, size_t size) {
+        const unsigned char* begin = static_cast<const unsigned char*>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+};
+
+struct delta_reader {
+    const unsigned char* at;
+    const unsigned char* end;
+    bool ok;
+
+    delta_reader(const void* data, size_t size) : at(static_cast<const unsigned char*>(data)), end(at + size), ok(true) {}
+
+    bool read(void* data, size_t size) {
+        if (!ok || (size_t)(end - at) < size)
+            return ok = false;
+        memcpy(data, at, size);
+        at += size;
+        return true;
+    }
+};
+
+// How a field's value is written into a delta. Defined for trivially
+// copyable types, std::string and std::vector; specialize it for others.
+template <typename F, typename = void> struct delta_codec;
+
+template <typename F> inline void delta_write(delta_writer& out, const F& value) {
+    delta_codec<F>::write(out, value);
+}
+
+template <typename F> inline bool delta_read(delta_reader& in, F& value) {
+    return delta_codec<F>::read(in, value);
+}
+
+template <typename F> struct delta_codec<F, typename std::enable_if<std::is_trivially_copyable<F>::value>::type> {
+    static void write(delta_writer& out, const F& value) { out.write(&value, sizeof(value)); }
+    static bool read(delta_reader& in, F& value) { return in.read(&value, sizeof(value)); }
+};
+
+template <> struct delta_codec<std::string> {
+    static void write(delta_writer& out, const std::string& value) {
+        uint32_t size = (uint32_t)value.size();
+        out.write(&size, sizeof(size));
+        out.write(value.data(), value.size());
+    }
+    static bool read(delta_reader& in, std::string& value) {
+        uint32_t size;
+        if (!in.read(&size, sizeof(size)) || (size_t)(in.end - in.at) < size)
+            return in.ok = false;
+        value.assign(reinterpret_cast<const char*>(in.at), size);
+        in.at += size;
+        return true;
+    }
+};
+
+template <typename T, typename Allocator> struct delta_codec<std::vector<T, Allocator>> {
+    static void write(delta_writer& out, const std::vector<T, Allocator>& value) {
+        uint32_t size = (uint32_t)value.size();
+        out.write(&size, sizeof(size));
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            out.write(value.data(), value.size() * sizeof(T));
+        } else {
+            for (const T& element : value)
+                delta_codec<T>::write(out, element);
+        }
+    }
+    static bool read(delta_reader& in, std::vector<T, Allocator>& value) {
+        uint32_t size;
+        if (!in.read(&size, sizeof(size)))
+            return false;
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            if ((size_t)(in.end - in.at) / sizeof(T) < size)
+                return in.ok = false;
+            value.resize(size);
+            return in.read(value.data(), (size_t)size * sizeof(T));
+        } else {
+            // Each element takes at least a byte, a bogus size fails here
+            // rather than in the allocation
+            if ((size_t)(in.end - in.at) < size)
+                return in.ok = false;
+            value.resize(size);
+            for (T& element : value)
+                if (!delta_codec<T>::read(in, element))
+                    return false;
+            return true;
+        }
+    }
+};
+
+} // namespace prx
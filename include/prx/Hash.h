@@ -0,0 +1,139 @@
+#pragma once
+
+// Hashing and equality for reflected types, for use as hash map keys:
+//
+//     std::unordered_map<Key, Value, prx::hash<Key>, prx::equal_to<Key>> cache;
+//
+// scan --generate defines both for every struct tagged PRX_HASH, from the
+// layout it extracted. A struct without padding whose fields are all
+// integers, enums, pointers or such structs is compared with one memcmp and
+// hashed a word at a time over its bytes. Other structs are compared field
+// by field in offset order, with runs of such fields still compared as bytes.
+//
+// The generated code has no operator== to offer, other translation units
+// couldn't see it; one that forwards is a line:
+//
+//     bool operator==(const Key& a, const Key& b) { return prx::equal_to<Key>()(a, b); }
+//
+// A struct with fields left out of reflection (PRX_NOREFLECT, bit-fields)
+// gets neither and the scanner reports it: keys that differ only in those
+// would compare equal. Bases have to be tagged PRX_HASH as well. Private
+// fields have to be of the kinds above, other fields are compared through
+// their own prx::equal_to.
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace prx {
+
+namespace detail {
+
+inline uint64_t hash_word(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+} // namespace detail
+
+// Size is usually a constant, the loop then unrolls into a few multiplies
+inline size_t hash_bytes(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = detail::hash_word(hash, word);
+    }
+    if (size) {
+        uint64_t word = 0;
+        memcpy(&word, bytes, size);
+        hash = detail::hash_word(hash, word);
+    }
+    return (size_t)detail::hash_word(hash, 0);
+}
+
+inline size_t hash_combine(size_t seed, size_t hash) {
+    return (size_t)detail::hash_word(seed, hash);
+}
+
+// The members are defined here for scalars, strings, vectors and arrays, and
+// by the generated file for structs tagged PRX_HASH
+template <typename T, typename = void> struct hash {
+    size_t operator()(const T& value) const;
+};
+
+template <typename T, typename = void> struct equal_to {
+    bool operator()(const T& a, const T& b) const;
+};
+
+template <typename T> inline size_t hash_value(const T& value) {
+    return hash<T>()(value);
+}
+
+template <typename T> inline bool equal_value(const T& a, const T& b) {
+    return equal_to<T>()(a, b);
+}
+
+template <typename T> struct hash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>::type> {
+    size_t operator()(T value) const { return hash_bytes(&value, sizeof(value)); }
+};
+
+template <typename T> struct hash<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    // 0.0 and -0.0 are equal and hash alike
+    size_t operator()(T value) const { return value == 0 ? hash_bytes("", 0) : hash_bytes(&value, sizeof(value)); }
+};
+
+template <typename T> struct equal_to<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>::type> {
+    bool operator()(T a, T b) const { return a == b; }
+};
+
+template <> struct hash<std::string> {
+    size_t operator()(const std::string& value) const { return hash_bytes(value.data(), value.size()); }
+};
+
+template <> struct equal_to<std::string> {
+    bool operator()(const std::string& a, const std::string& b) const { return a == b; }
+};
+
+template <typename T, typename Allocator> struct hash<std::vector<T, Allocator>> {
+    size_t operator()(const std::vector<T, Allocator>& value) const {
+        size_t result = hash_bytes("", 0);
+        for (const T& element : value)
+            result = hash_combine(result, hash<T>()(element));
+        return result;
+    }
+};
+
+template <typename T, typename Allocator> struct equal_to<std::vector<T, Allocator>> {
+    bool operator()(const std::vector<T, Allocator>& a, const std::vector<T, Allocator>& b) const {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (!equal_to<T>()(a[i], b[i]))
+                return false;
+        return true;
+    }
+};
+
+template <typename T, size_t N> struct hash<T[N]> {
+    size_t operator()(const T (&value)[N]) const {
+        size_t result = hash_bytes("", 0);
+        for (size_t i = 0; i < N; i++)
+            result = hash_combine(result, hash<T>()(value[i]));
+        return result;
+    }
+};
+
+template <typename T, size_t N> struct equal_to<T[N]> {
+    bool operator()(const T (&a)[N], const T (&b)[N]) const {
+        for (size_t i = 0; i < N; i++)
+            if (!equal_to<T>()(a[i], b[i]))
+                return false;
+        return true;
+    }
+};
+
+} // namespace prx
@@ -0,0 +1,83 @@
+#pragma once
+
+// Type-erased calls of reflected functions. scan --generate emits one thunk
+// per reflected function and method; calling through a thunk costs an
+// indirect call and nothing else, no boxing and no heap allocation.
+//
+//     int damage = 10;
+//     void* args[] = { &damage };
+//     bool killed;
+//     thunk(&player, args, &killed);
+//
+// args points to one pointer per parameter, each to a value of exactly the
+// parameter's type with references removed. Arguments taken by value are
+// copied from there, rvalue reference parameters are moved from. The return
+// value is constructed in result, or for a reference return its address is
+// stored there. object is ignored for free and static functions.
+
+#include <new>
+#include <stddef.h>
+
+namespace prx {
+
+typedef void (*invoke_thunk)(void* object, void* const* args, void* result);
+
+struct function_entry {
+    // Fully qualified for free functions, Type::method for methods
+    const char* name;
+    const char* signature;
+    invoke_thunk invoke;
+    unsigned param_count;
+    // Linker symbol, see prx/Bind.h; null when there is none
+    const char* symbol;
+};
+
+// A free variable or a static data member
+struct variable_entry {
+    const char* name;
+    const char* symbol;
+};
+
+namespace detail {
+
+template <typename T> struct arg_access {
+    static T& get(void* arg) { return *static_cast<T*>(arg); }
+};
+template <typename T> struct arg_access<T&> {
+    static T& get(void* arg) { return *static_cast<T*>(arg); }
+};
+template <typename T> struct arg_access<T&&> {
+    static T&& get(void* arg) { return static_cast<T&&>(*static_cast<T*>(arg)); }
+};
+
+template <typename R> struct result_access {
+    template <typename V> static void store(void* result, V&& value) { new (result) R(static_cast<V&&>(value)); }
+};
+template <typename R> struct result_access<R&> {
+    static void store(void* result, R& value) { *static_cast<R**>(result) = &value; }
+};
+template <typename R> struct result_access<R&&> {
+    static void store(void* result, R&& value) { *static_cast<R**>(result) = &value; }
+};
+
+} // namespace detail
+
+// The reflected functions, methods and variables, defined in the file scan --generate
+// writes
+namespace generated {
+extern const function_entry functions[];
+extern const size_t function_count;
+extern const variable_entry variables[];
+extern const size_t variable_count;
+} // namespace generated
+
+// Used by generated thunks
+template <typename T> inline decltype(auto) arg(void* const* args, size_t index) {
+    return detail::arg_access<T>::get(args[index]);
+}
+
+template <typename R, typename V> inline void store_result(void* result, V&& value) {
+    detail::result_access<R>::store(result, static_cast<V&&>(value));
+}
+
+} // namespace prx
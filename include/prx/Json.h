@@ -0,0 +1,411 @@
+#pragma once
+
+// JSON for reflected types. scan --generate writes a reader and a writer for
+// every struct and enum tagged PRX_JSON: keys are written as literal bytes
+// and read back through a switch on the key's length and a perfect hash of
+// its characters, so neither direction looks at type metadata at run time.
+//
+//     std::string text;
+//     prx::to_json(player, &text);
+//     bool ok = prx::from_json(text.data(), text.size(), &player);
+//
+// Only public fields are serialized, those of reflected bases included.
+// Reading leaves fields the input doesn't mention alone and skips keys the
+// type doesn't have. Fields hold arithmetic types, std::string, std::vector,
+// arrays or other PRX_JSON types; a field of any other type fails to link.
+// Floating point values that JSON can't represent are written as null and
+// read back as NaN.
+
+#include <charconv>
+#include <limits>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace prx {
+
+struct json_writer {
+    std::string out;
+
+    void raw(const char* data, size_t size) { out.append(data, size); }
+    void raw(char c) { out += c; }
+    void string(const char* data, size_t size);
+};
+
+struct json_reader {
+    const char* at;
+    const char* end;
+    bool ok;
+    // Keys with escapes are decoded here, the rest point into the input
+    std::string key_buffer;
+
+    json_reader(const char* data, size_t size) : at(data), end(data + size), ok(true) {}
+
+    bool fail() { ok = false; return false; }
+    void skip_space() {
+        while (at < end && (*at == ' ' || *at == '\t' || *at == '\n' || *at == '\r'))
+            at++;
+    }
+    bool peek(char c) {
+        skip_space();
+        return at < end && *at == c;
+    }
+    bool consume(char c) {
+        if (!peek(c))
+            return false;
+        at++;
+        return true;
+    }
+    bool literal(const char* text, size_t size) {
+        skip_space();
+        if ((size_t)(end - at) < size || memcmp(at, text, size) != 0)
+            return false;
+        at += size;
+        return true;
+    }
+
+    bool string(std::string* value);
+    bool string_view(const char** data, size_t* size);
+    // Loops over an object: call begin_object, then next_key until it returns
+    // false, reading each key's value in between
+    bool begin_object() { return consume('{') || fail(); }
+    bool next_key(const char** key, size_t* size, bool first);
+    bool begin_array() { return consume('[') || fail(); }
+    bool next_element(bool first);
+    bool skip_value();
+};
+
+// The reader and writer of a type. The members are defined here for the
+// types JSON has a representation for, and by the generated file for types
+// tagged PRX_JSON.
+template <typename T, typename = void> struct json {
+    static void write(json_writer& out, const T& value);
+    static bool read(json_reader& in, T& value);
+};
+
+template <typename T> inline void json_write(json_writer& out, const T& value) {
+    json<T>::write(out, value);
+}
+
+template <typename T> inline bool json_read(json_reader& in, T& value) {
+    return json<T>::read(in, value);
+}
+
+template <typename T> inline void to_json(const T& value, std::string* text) {
+    json_writer out;
+    out.out.swap(*text);
+    json<T>::write(out, value);
+    out.out.swap(*text);
+}
+
+// Fails on anything but whitespace after the value
+template <typename T> inline bool from_json(const char* data, size_t size, T* value) {
+    json_reader in(data, size);
+    if (!json<T>::read(in, *value))
+        return false;
+    in.skip_space();
+    return in.ok && in.at == in.end;
+}
+
+template <> struct json<bool> {
+    static void write(json_writer& out, bool value) {
+        if (value)
+            out.raw("true", 4);
+        else
+            out.raw("false", 5);
+    }
+    static bool read(json_reader& in, bool& value) {
+        if (in.literal("true", 4))
+            value = true;
+        else if (in.literal("false", 5))
+            value = false;
+        else
+            return in.fail();
+        return true;
+    }
+};
+
+template <typename T> struct json<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static void write(json_writer& out, T value) {
+        char buffer[24];
+        std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.raw(buffer, (size_t)(result.ptr - buffer));
+    }
+    static bool read(json_reader& in, T& value) {
+        in.skip_space();
+        std::from_chars_result result = std::from_chars(in.at, in.end, value);
+        if (result.ec != std::errc() || result.ptr == in.at)
+            return in.fail();
+        in.at = result.ptr;
+        return true;
+    }
+};
+
+template <typename T> struct json<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static void write(json_writer& out, T value) {
+        if (value != value || value - value != 0) {
+            out.raw("null", 4);
+            return;
+        }
+        char buffer[32];
+        std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.raw(buffer, (size_t)(result.ptr - buffer));
+    }
+    static bool read(json_reader& in, T& value) {
+        if (in.literal("null", 4)) {
+            value = std::numeric_limits<T>::quiet_NaN();
+            return true;
+        }
+        std::from_chars_result result = std::from_chars(in.at, in.end, value);
+        if (result.ec != std::errc() || result.ptr == in.at)
+            return in.fail();
+        in.at = result.ptr;
+        return true;
+    }
+};
+
+template <> struct json<std::string> {
+    static void write(json_writer& out, const std::string& value) { out.string(value.data(), value.size()); }
+    static bool read(json_reader& in, std::string& value) { return in.string(&value); }
+};
+
+template <typename T, typename Allocator> struct json<std::vector<T, Allocator>> {
+    static void write(json_writer& out, const std::vector<T, Allocator>& value) {
+        out.raw('[');
+        for (size_t i = 0; i < value.size(); i++) {
+            if (i)
+                out.raw(',');
+            json<T>::write(out, value[i]);
+        }
+        out.raw(']');
+    }
+    static bool read(json_reader& in, std::vector<T, Allocator>& value) {
+        value.clear();
+        if (!in.begin_array())
+            return false;
+        for (bool first = true; in.next_element(first); first = false) {
+            value.emplace_back();
+            if (!json<T>::read(in, value.back()))
+                return false;
+        }
+        return in.ok;
+    }
+};
+
+// Reading fails when the input has more elements than the array
+template <typename T, size_t N> struct json<T[N]> {
+    static void write(json_writer& out, const T (&value)[N]) {
+        out.raw('[');
+        for (size_t i = 0; i < N; i++) {
+            if (i)
+                out.raw(',');
+            json<T>::write(out, value[i]);
+        }
+        out.raw(']');
+    }
+    static bool read(json_reader& in, T (&value)[N]) {
+        if (!in.begin_array())
+            return false;
+        size_t i = 0;
+        for (bool first = true; in.next_element(first); first = false) {
+            if (i == N || !json<T>::read(in, value[i++]))
+                return in.fail();
+        }
+        return in.ok;
+    }
+};
+
+inline void json_writer::string(const char* data, size_t size) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = (unsigned char)data[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        out.append(data + run, i - run);
+        run = i + 1;
+        char escape[6] = { '\\', (char)c, 0, 0, 0, 0 };
+        size_t length = 2;
+        switch (c) {
+        case '"': case '\\': break;
+        case '\n': escape[1] = 'n'; break;
+        case '\r': escape[1] = 'r'; break;
+        case '\t': escape[1] = 't'; break;
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = hex[c >> 4];
+            escape[5] = hex[c & 15];
+            length = 6;
+            break;
+        }
+        out.append(escape, length);
+    }
+    out.append(data + run, size - run);
+    out += '"';
+}
+
+namespace detail {
+
+inline int hex_digit(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+inline void append_utf8(std::string* out, unsigned long code) {
+    if (code < 0x80) {
+        *out += (char)code;
+    } else if (code < 0x800) {
+        *out += (char)(0xc0 | (code >> 6));
+        *out += (char)(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        *out += (char)(0xe0 | (code >> 12));
+        *out += (char)(0x80 | ((code >> 6) & 0x3f));
+        *out += (char)(0x80 | (code & 0x3f));
+    } else {
+        *out += (char)(0xf0 | (code >> 18));
+        *out += (char)(0x80 | ((code >> 12) & 0x3f));
+        *out += (char)(0x80 | ((code >> 6) & 0x3f));
+        *out += (char)(0x80 | (code & 0x3f));
+    }
+}
+
+} // namespace detail
+
+// Decodes the string at the reader into value, which keeps its capacity
+inline bool json_reader::string(std::string* value) {
+    if (!consume('"'))
+        return fail();
+    value->clear();
+    while (at < end && *at != '"') {
+        const char* run = at;
+        while (at < end && *at != '"' && *at != '\\')
+            at++;
+        value->append(run, (size_t)(at - run));
+        if (at == end || *at == '"')
+            break;
+        if (end - at < 2)
+            return fail();
+        char c = at[1];
+        at += 2;
+        switch (c) {
+        case '"': case '\\': case '/': *value += c; break;
+        case 'b': *value += '\b'; break;
+        case 'f': *value += '\f'; break;
+        case 'n': *value += '\n'; break;
+        case 'r': *value += '\r'; break;
+        case 't': *value += '\t'; break;
+        case 'u': {
+            unsigned long code = 0;
+            for (int i = 0; i < 4; i++) {
+                int digit = at + i < end ? detail::hex_digit(at[i]) : -1;
+                if (digit < 0)
+                    return fail();
+                code = code << 4 | (unsigned long)digit;
+            }
+            at += 4;
+            // A high surrogate followed by a low one is a single code point
+            if (code >= 0xd800 && code < 0xdc00 && end - at >= 6 && at[0] == '\\' && at[1] == 'u') {
+                unsigned long low = 0;
+                for (int i = 2; i < 6; i++) {
+                    int digit = detail::hex_digit(at[i]);
+                    if (digit < 0)
+                        return fail();
+                    low = low << 4 | (unsigned long)digit;
+                }
+                if (low >= 0xdc00 && low < 0xe000) {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    at += 6;
+                }
+            }
+            detail::append_utf8(value, code);
+        } break;
+        default:
+            return fail();
+        }
+    }
+    if (at == end)
+        return fail();
+    at++;
+    return true;
+}
+
+// A string without escapes is returned in place, others are decoded into
+// key_buffer
+inline bool json_reader::string_view(const char** data, size_t* size) {
+    if (!peek('"'))
+        return fail();
+    const char* begin = at + 1;
+    const char* it = begin;
+    while (it < end && *it != '"' && *it != '\\')
+        it++;
+    if (it < end && *it == '"') {
+        *data = begin;
+        *size = (size_t)(it - begin);
+        at = it + 1;
+        return true;
+    }
+    if (!string(&key_buffer))
+        return false;
+    *data = key_buffer.data();
+    *size = key_buffer.size();
+    return true;
+}
+
+inline bool json_reader::next_key(const char** key, size_t* size, bool first) {
+    if (consume('}'))
+        return false;
+    if (!first && !consume(','))
+        return fail();
+    return string_view(key, size) && (consume(':') || fail());
+}
+
+inline bool json_reader::next_element(bool first) {
+    if (consume(']'))
+        return false;
+    return first || consume(',') || fail();
+}
+
+inline bool json_reader::skip_value() {
+    skip_space();
+    if (at == end)
+        return fail();
+    if (*at == '"') {
+        const char* data;
+        size_t size;
+        return string_view(&data, &size);
+    }
+    if (*at == '{') {
+        at++;
+        const char* key;
+        size_t size;
+        for (bool first = true; next_key(&key, &size, first); first = false) {
+            if (!skip_value())
+                return false;
+        }
+        return ok;
+    }
+    if (*at == '[') {
+        at++;
+        for (bool first = true; next_element(first); first = false) {
+            if (!skip_value())
+                return false;
+        }
+        return ok;
+    }
+    // A number or a literal
+    const char* begin = at;
+    while (at < end && (*at == '-' || *at == '+' || *at == '.' || (*at >= '0' && *at <= '9') || (*at >= 'a' && *at <= 'z') || (*at >= 'A' && *at <= 'Z')))
+        at++;
+    return at != begin || fail();
+}
+
+} // namespace prx
@@ -0,0 +1,176 @@
+#pragma once
+
+// Slab pools for reflected types, set up from the registry alone: the slot
+// size and alignment come from the type's record, construction and
+// destruction go through its lifetime thunks. One pool_set serves every type
+// without a pool written per type:
+//
+//     prx::pool_set pools;
+//     Player* player = pools.create<Player>();
+//     void* objects[256];
+//     pools.create(id, objects, 256); // constructed in runs of adjacent slots
+//     pools.destroy(id, objects, 256);
+//
+//     for (const prx::pool_stats& stats : pools.stats())
+//         printf("%s %zu live, %zu bytes\n", types.type_name(stats.type), stats.live, stats.live_bytes);
+//
+// Slots freed go on a free list and are reused before slab space that was
+// never handed out. Memory is returned only when the pool is destroyed, which
+// doesn't destroy the objects still live. Pools aren't synchronized.
+
+#include <new>
+#include <stddef.h>
+#include <vector>
+
+#include <prx/Registry.h>
+
+namespace prx {
+
+struct pool_stats {
+    type_id type;
+    size_t live;
+    size_t live_bytes;
+    // Slab memory held, live or not
+    size_t reserved_bytes;
+};
+
+class type_pool {
+public:
+    type_pool(const type_record& type, size_t slab_bytes = 64 * 1024) : type_(type), free_(0), next_(0), end_(0), live_(0) {
+        align_ = type.align > alignof(void*) ? type.align : alignof(void*);
+        // A free slot holds the free list link
+        stride_ = type.size > sizeof(void*) ? (size_t)type.size : sizeof(void*);
+        stride_ = (stride_ + align_ - 1) & ~(align_ - 1);
+        slab_bytes_ = slab_bytes > stride_ ? slab_bytes - slab_bytes % stride_ : stride_;
+    }
+    type_pool(const type_pool&) = delete;
+    type_pool& operator=(const type_pool&) = delete;
+    ~type_pool() {
+        for (void* slab : slabs_)
+            ::operator delete(slab, std::align_val_t(align_));
+    }
+
+    // Uninitialized memory for one object
+    void* allocate() {
+        live_++;
+        if (free_) {
+            void* slot = free_;
+            free_ = *static_cast<void**>(slot);
+            return slot;
+        }
+        if (next_ == end_)
+            grow();
+        void* slot = next_;
+        next_ += stride_;
+        return slot;
+    }
+    void deallocate(void* slot) {
+        *static_cast<void**>(slot) = free_;
+        free_ = slot;
+        live_--;
+    }
+
+    // A default constructed object, null when the type can't be constructed
+    // through its record
+    void* create() {
+        void* object;
+        return create(&object, 1) ? object : 0;
+    }
+    void destroy(void* object) { destroy(&object, 1); }
+
+    // Stores count new objects in objects. Slots that are adjacent in memory
+    // are constructed with one call of the thunk.
+    bool create(void** objects, size_t count) {
+        if (!type_.ops || !type_.ops->construct)
+            return false;
+        for (size_t i = 0; i < count; i++)
+            objects[i] = allocate();
+        for_each_run(objects, count, type_.ops->construct);
+        return true;
+    }
+    void destroy(void* const* objects, size_t count) {
+        if (!(type_.flags & type_trivially_destructible) && type_.ops && type_.ops->destroy)
+            for_each_run(objects, count, type_.ops->destroy);
+        for (size_t i = 0; i < count; i++)
+            deallocate(objects[i]);
+    }
+
+    size_t live() const { return live_; }
+    size_t live_bytes() const { return live_ * (size_t)type_.size; }
+    size_t reserved_bytes() const { return slabs_.size() * slab_bytes_; }
+
+private:
+    void grow() {
+        next_ = static_cast<char*>(::operator new(slab_bytes_, std::align_val_t(align_)));
+        end_ = next_ + slab_bytes_;
+        slabs_.push_back(next_);
+    }
+
+    void for_each_run(void* const* objects, size_t count, lifetime_thunk thunk) {
+        for (size_t first = 0; first < count;) {
+            size_t last = first + 1;
+            while (last < count && static_cast<char*>(objects[last]) == static_cast<char*>(objects[last - 1]) + stride_)
+                last++;
+            if (stride_ == type_.size) {
+                thunk(objects[first], last - first);
+            } else {
+                // Slots padded past the type's size aren't an array of it
+                for (size_t i = first; i < last; i++)
+                    thunk(objects[i], 1);
+            }
+            first = last;
+        }
+    }
+
+    const type_record& type_;
+    size_t align_;
+    size_t stride_;
+    size_t slab_bytes_;
+    std::vector<void*> slabs_;
+    void* free_;
+    char* next_;
+    char* end_;
+    size_t live_;
+};
+
+// A pool per type id, created on the type's first allocation
+class pool_set {
+public:
+    explicit pool_set(const registry& types = registry::generated()) : types_(types), pools_(types.type_count()) {}
+    pool_set(const pool_set&) = delete;
+    pool_set& operator=(const pool_set&) = delete;
+    ~pool_set() {
+        for (type_pool* pool : pools_)
+            delete pool;
+    }
+
+    type_pool& pool(type_id type) {
+        if (!pools_[type])
+            pools_[type] = new type_pool(types_.type(type));
+        return *pools_[type];
+    }
+
+    void* create(type_id type) { return pool(type).create(); }
+    void destroy(type_id type, void* object) { pool(type).destroy(object); }
+    bool create(type_id type, void** objects, size_t count) { return pool(type).create(objects, count); }
+    void destroy(type_id type, void* const* objects, size_t count) { pool(type).destroy(objects, count); }
+
+    template <typename T> T* create() { return static_cast<T*>(create(reflect<T>::id)); }
+    template <typename T> void destroy(T* object) { destroy(reflect<T>::id, object); }
+
+    // The types that have a pool
+    std::vector<pool_stats> stats() const {
+        std::vector<pool_stats> result;
+        for (size_t type = 0; type < pools_.size(); type++) {
+            if (pools_[type])
+                result.push_back({ (type_id)type, pools_[type]->live(), pools_[type]->live_bytes(), pools_[type]->reserved_bytes() });
+        }
+        return result;
+    }
+
+private:
+    const registry& types_;
+    std::vector<type_pool*> pools_;
+};
+
+} // namespace prx
@@ -0,0 +1,70 @@
+#pragma once
+
+// Compile-time reflection. The header scan --generate-header writes
+// specializes prx::reflect for every reflected struct and class:
+//
+//     template <> struct reflect<Player> {
+//         static constexpr type_id id = 12;
+//         static constexpr const char* name = "Player";
+//         typedef type_list<Entity> bases;
+//         static constexpr size_t field_count = 2;
+//         static constexpr auto fields = std::make_tuple(
+//             field_descriptor<Player, int>{ &Player::health, "health", 16 }, ...);
+//     };
+//
+// Everything in it is a constant, so code over the fields unrolls at compile
+// time and compiles to the same accesses as code written by hand:
+//
+//     prx::for_each_field(player, [&](const auto& field, auto& value) {
+//         write(out, field.name, value);
+//     });
+//
+// Only public fields are listed, a member pointer to any other can't be
+// formed outside the class. Reference members aren't listed either. Offsets
+// are the ones the scanner extracted, under the flags it was given. bases
+// lists the reflected bases, which have to be public.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+
+namespace prx {
+
+// A type's index in the tables scan --generate writes, see prx/Registry.h
+typedef uint32_t type_id;
+constexpr type_id invalid_type_id = 0xffffffffu;
+
+template <typename T> struct reflect;
+
+template <typename... T> struct type_list {};
+
+template <typename C, typename F> struct field_descriptor {
+    typedef C class_type;
+    typedef F type;
+
+    F C::*pointer;
+    const char* name;
+    size_t offset;
+};
+
+template <typename T, typename Function> void for_each_field(T& object, Function&& function);
+
+namespace detail {
+
+template <typename T, typename Function, typename... Bases> inline void for_each_base_field(T& object, Function& function, type_list<Bases...>) {
+    (for_each_field(static_cast<typename std::conditional<std::is_const<T>::value, const Bases, Bases>::type&>(object), function), ...);
+}
+
+} // namespace detail
+
+// Calls function(descriptor, value) for every field of object, those of the
+// reflected bases first. value is a reference to the field, const when object
+// is.
+template <typename T, typename Function> inline void for_each_field(T& object, Function&& function) {
+    typedef reflect<typename std::remove_const<T>::type> info;
+    detail::for_each_base_field(object, function, typename info::bases());
+    std::apply([&](const auto&... field) { (function(field, object.*field.pointer), ...); }, info::fields);
+}
+
+} // namespace prx
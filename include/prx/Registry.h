@@ -0,0 +1,303 @@
+#pragma once
+
+// The reflected types at run time. scan --generate writes the tables this
+// reads: a dense id per type, and for each type a 64-byte record holding
+// what lookups touch in the hot path. Names and other strings sit in
+// separate cold tables and are read only to confirm a name match or to
+// print.
+//
+//     const prx::registry& types = prx::registry::generated();
+//     prx::type_id id = types.find("game::Player");
+//     const prx::type_record& player = types.type(id); // one indexed load
+//     for (const prx::field_record& field : types.fields(id)) ...
+//
+// Ids are indices into the tables, and reflect<T>::id in the header from
+// --generate-header is the same id when both come from one database. Sizes,
+// alignments and flags are taken from the compiled types themselves, field
+// offsets from the scan. A field's type is an id when that type is reflected.
+// Types the generated code can name also get lifetime thunks in ops.
+//
+// A field is found by name through a perfect hash over the type's field
+// names that the scanner builds: two indexed loads pick the only candidate,
+// and a compare confirms it.
+
+#include <new>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+#include <prx/Reflect.h>
+
+namespace prx {
+
+enum type_flags : uint32_t {
+    type_enum = 1 << 0,
+    type_trivially_copyable = 1 << 1,
+    type_trivially_destructible = 1 << 2,
+    type_default_constructible = 1 << 3,
+    type_polymorphic = 1 << 4,
+    type_abstract = 1 << 5,
+};
+
+enum field_flags : uint32_t {
+    field_public = 1 << 0,
+    // Comparable and hashable as its bytes
+    field_bitwise = 1 << 1,
+};
+
+typedef void (*lifetime_thunk)(void* at, size_t count);
+typedef void (*copy_thunk)(void* to, const void* from);
+typedef void (*move_thunk)(void* to, void* from);
+
+// Lifetime thunks. construct and destroy go over count objects at consecutive
+// addresses so a batch costs one indirect call. copy and move construct one
+// object at to from the one at from, which move leaves to be destroyed.
+// construct is null for types that can't be default constructed, destroy for
+// trivially destructible ones, copy and move for types that can't be copied
+// or moved.
+struct type_ops {
+    lifetime_thunk construct;
+    lifetime_thunk destroy;
+    copy_thunk copy;
+    move_thunk move;
+};
+
+namespace detail {
+
+template <typename T> void construct_n(void* at, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        new (static_cast<T*>(at) + i) T();
+}
+
+template <typename T> void destroy_n(void* at, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        (static_cast<T*>(at) + i)->~T();
+}
+
+template <typename T> void copy_one(void* to, const void* from) {
+    new (to) T(*static_cast<const T*>(from));
+}
+
+template <typename T> void move_one(void* to, void* from) {
+    new (to) T(static_cast<T&&>(*static_cast<T*>(from)));
+}
+
+// Taking a thunk's address instantiates it, which has to be avoided for
+// types it doesn't compile for
+template <typename T> constexpr lifetime_thunk construct_thunk_of() {
+    if constexpr (std::is_default_constructible<T>::value && !std::is_abstract<T>::value)
+        return &construct_n<T>;
+    else
+        return 0;
+}
+
+template <typename T> constexpr lifetime_thunk destroy_thunk_of() {
+    if constexpr (std::is_trivially_destructible<T>::value)
+        return 0;
+    else
+        return &destroy_n<T>;
+}
+
+template <typename T> constexpr copy_thunk copy_thunk_of() {
+    if constexpr (std::is_copy_constructible<T>::value && !std::is_abstract<T>::value)
+        return &copy_one<T>;
+    else
+        return 0;
+}
+
+template <typename T> constexpr move_thunk move_thunk_of() {
+    if constexpr (std::is_move_constructible<T>::value && !std::is_abstract<T>::value)
+        return &move_one<T>;
+    else
+        return 0;
+}
+
+} // namespace detail
+
+template <typename T> struct type_ops_of {
+    static constexpr type_ops value = { detail::construct_thunk_of<T>(), detail::destroy_thunk_of<T>(), detail::copy_thunk_of<T>(),
+                                        detail::move_thunk_of<T>() };
+};
+
+struct alignas(64) type_record {
+    uint64_t size;
+    uint32_t align;
+    uint32_t flags;
+    uint64_t name_hash;
+    // The type's own fields, fields()[field_first, field_first + field_count)
+    uint32_t field_first;
+    uint32_t field_count;
+    // Its perfect hash over the field names, a power of two of field_slots
+    // from field_slot_first; none when field_slot_count is 0
+    uint32_t field_slot_first;
+    uint32_t field_slot_count;
+    // Ids of its reflected bases, in bases()
+    uint32_t base_first;
+    uint32_t base_count;
+    // Null for types the generated code can't name
+    const type_ops* ops;
+};
+static_assert(sizeof(type_record) == 64, "a type record is one cache line");
+
+struct field_record {
+    uint64_t name_hash;
+    uint32_t offset;
+    uint32_t size;
+    type_id type;
+    uint32_t flags;
+};
+
+// Strings of a field, indexed like field_record
+struct field_names {
+    const char* name;
+    // As written in the declaration
+    const char* type;
+};
+
+// A slot of a type's field name hash. The low bits of a name's hash pick a
+// bucket, whose seed is in the slot of that index; the name's hash mixed with
+// the seed picks the slot holding the field, an index from field_first.
+struct field_slot {
+    uint32_t seed;
+    uint32_t field;
+};
+
+// The scanner searches seeds with the same function
+constexpr uint32_t field_slot_of(uint64_t name_hash, uint32_t seed) {
+    return (uint32_t)(((name_hash ^ seed) * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+template <typename T> constexpr uint32_t type_flags_of() {
+    uint32_t flags = 0;
+    flags |= std::is_enum<T>::value ? (uint32_t)type_enum : 0;
+    flags |= std::is_trivially_copyable<T>::value ? (uint32_t)type_trivially_copyable : 0;
+    flags |= std::is_trivially_destructible<T>::value ? (uint32_t)type_trivially_destructible : 0;
+    flags |= std::is_default_constructible<T>::value ? (uint32_t)type_default_constructible : 0;
+    flags |= std::is_polymorphic<T>::value ? (uint32_t)type_polymorphic : 0;
+    flags |= std::is_abstract<T>::value ? (uint32_t)type_abstract : 0;
+    return flags;
+}
+
+// FNV-1a, the scanner hashes names the same way
+constexpr uint64_t hash_name(const char* name, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ (unsigned char)name[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+// Defined in the file scan --generate writes
+namespace generated {
+extern const type_record types[];
+extern const char* const type_names[];
+extern const size_t type_count;
+extern const field_record fields[];
+extern const field_names field_strings[];
+extern const size_t field_count;
+extern const field_slot field_slots[];
+extern const type_id bases[];
+extern const size_t base_count;
+} // namespace generated
+
+template <typename T> struct record_range {
+    const T* first;
+    const T* last;
+    const T* begin() const { return first; }
+    const T* end() const { return last; }
+    size_t size() const { return (size_t)(last - first); }
+    const T& operator[](size_t index) const { return first[index]; }
+};
+
+class registry {
+public:
+    registry(const type_record* types, const char* const* type_names, size_t type_count, const field_record* fields,
+             const field_names* field_strings, const field_slot* field_slots, const type_id* bases)
+        : types_(types), type_names_(type_names), type_count_(type_count), fields_(fields), field_strings_(field_strings), field_slots_(field_slots),
+          bases_(bases) {
+        // Open addressing over a power of two at least twice the type count,
+        // so probes stay short
+        size_t capacity = 16;
+        while (capacity < type_count * 2)
+            capacity *= 2;
+        slots_.assign(capacity, invalid_type_id);
+        for (size_t id = 0; id < type_count; id++) {
+            size_t slot = (size_t)types[id].name_hash & (capacity - 1);
+            while (slots_[slot] != invalid_type_id)
+                slot = (slot + 1) & (capacity - 1);
+            slots_[slot] = (type_id)id;
+        }
+    }
+
+    // The registry over the generated tables, built on first use
+    static const registry& generated() {
+        static const registry instance(prx::generated::types, prx::generated::type_names, prx::generated::type_count, prx::generated::fields,
+                                       prx::generated::field_strings, prx::generated::field_slots, prx::generated::bases);
+        return instance;
+    }
+
+    size_t type_count() const { return type_count_; }
+    const type_record& type(type_id id) const { return types_[id]; }
+    const char* type_name(type_id id) const { return type_names_[id]; }
+
+    record_range<field_record> fields(type_id id) const {
+        const type_record& type = types_[id];
+        return { fields_ + type.field_first, fields_ + type.field_first + type.field_count };
+    }
+    const field_names& field_strings(const field_record& field) const { return field_strings_[&field - fields_]; }
+    record_range<type_id> bases(type_id id) const {
+        const type_record& type = types_[id];
+        return { bases_ + type.base_first, bases_ + type.base_first + type.base_count };
+    }
+
+    type_id find(const char* name, size_t size) const {
+        uint64_t hash = hash_name(name, size);
+        for (size_t slot = (size_t)hash & (slots_.size() - 1);; slot = (slot + 1) & (slots_.size() - 1)) {
+            type_id id = slots_[slot];
+            if (id == invalid_type_id)
+                return invalid_type_id;
+            if (types_[id].name_hash == hash && strncmp(type_names_[id], name, size) == 0 && type_names_[id][size] == 0)
+                return id;
+        }
+    }
+    type_id find(const char* name) const { return find(name, strlen(name)); }
+
+    // A field of the type itself, bases aren't searched; null when there is
+    // none
+    const field_record* find_field(type_id id, const char* name, size_t size) const {
+        uint64_t hash = hash_name(name, size);
+        const type_record& type = types_[id];
+        if (type.field_slot_count) {
+            const field_slot* slots = field_slots_ + type.field_slot_first;
+            uint32_t mask = type.field_slot_count - 1;
+            uint32_t seed = slots[(uint32_t)hash & mask].seed;
+            const field_record& field = fields_[type.field_first + slots[field_slot_of(hash, seed) & mask].field];
+            return matches(field, hash, name, size) ? &field : 0;
+        }
+        // The scanner found no perfect hash, which only a collision of name
+        // hashes makes likely
+        for (const field_record& field : fields(id)) {
+            if (matches(field, hash, name, size))
+                return &field;
+        }
+        return 0;
+    }
+    const field_record* find_field(type_id id, const char* name) const { return find_field(id, name, strlen(name)); }
+
+private:
+    bool matches(const field_record& field, uint64_t hash, const char* name, size_t size) const {
+        const char* field_name = field_strings_[&field - fields_].name;
+        return field.name_hash == hash && strncmp(field_name, name, size) == 0 && field_name[size] == 0;
+    }
+
+    const type_record* types_;
+    const char* const* type_names_;
+    size_t type_count_;
+    const field_record* fields_;
+    const field_names* field_strings_;
+    const field_slot* field_slots_;
+    const type_id* bases_;
+    std::vector<type_id> slots_;
+};
+
+} // namespace prx
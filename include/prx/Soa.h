@@ -0,0 +1,293 @@
+#pragma once
+
+// Struct-of-arrays storage for reflected structs. For every struct tagged
+// PRX_SOA, the header scan --generate-header writes specializes
+// prx::soa_vector: one contiguous column per field, each 64-byte aligned,
+// behind an interface close to std::vector's.
+//
+//     prx::soa_vector<Particle> particles;
+//     particles.push_back({ 0, 0, 1, 1 });
+//     for (auto p : particles)
+//         p.x += p.vx;
+//     float* x = particles.x().data(); // a plain array for SIMD loops
+//
+// Elements are stored field by field, so the indexing operator and the
+// iterators hand out a proxy with one reference per field rather than a T&.
+// A proxy converts to T and assigns from one. Every field of the struct
+// has to be public, and the struct can't have bases. Fields left out of
+// reflection (PRX_NOREFLECT, bit-fields) aren't stored.
+
+#include <new>
+#include <stddef.h>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace prx {
+
+template <typename T> class soa_vector;
+
+// One column: a contiguous array of size values of one field
+template <typename F> class column_view {
+public:
+    column_view(F* data, size_t size) : data_(data), size_(size) {}
+    F* data() const { return data_; }
+    size_t size() const { return size_; }
+    F* begin() const { return data_; }
+    F* end() const { return data_ + size_; }
+    F& operator[](size_t index) const { return data_[index]; }
+
+private:
+    F* data_;
+    size_t size_;
+};
+
+namespace detail {
+
+template <typename M> struct member_type;
+template <typename C, typename F> struct member_type<F C::*> {
+    typedef F type;
+};
+
+// Arrays can't be constructed or assigned as a whole, these go element by
+// element
+template <typename F> inline void soa_construct(F* at) {
+    if constexpr (std::is_array<F>::value) {
+        for (size_t i = 0; i < std::extent<F>::value; i++)
+            soa_construct(&(*at)[i]);
+    } else {
+        new (at) F();
+    }
+}
+
+template <typename F, typename V> inline void soa_construct(F* at, V&& value) {
+    if constexpr (std::is_array<F>::value) {
+        for (size_t i = 0; i < std::extent<F>::value; i++)
+            soa_construct(&(*at)[i], std::forward<V>(value)[i]);
+    } else {
+        new (at) F(std::forward<V>(value));
+    }
+}
+
+template <typename F> inline void soa_destroy(F* at) {
+    if constexpr (std::is_array<F>::value) {
+        for (size_t i = 0; i < std::extent<F>::value; i++)
+            soa_destroy(&(*at)[i]);
+    } else {
+        at->~F();
+    }
+}
+
+template <typename F, typename V> inline void soa_assign(F& to, V&& value) {
+    if constexpr (std::is_array<F>::value) {
+        for (size_t i = 0; i < std::extent<F>::value; i++)
+            soa_assign(to[i], std::forward<V>(value)[i]);
+    } else {
+        to = std::forward<V>(value);
+    }
+}
+
+} // namespace detail
+
+// Iterates a soa_vector by index, dereferencing to the vector's proxy
+template <typename Vector, typename Reference> class soa_iterator {
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef typename std::remove_const<Vector>::type::value_type value_type;
+    typedef ptrdiff_t difference_type;
+    typedef void pointer;
+    typedef Reference reference;
+
+    soa_iterator() : vector(0), index(0) {}
+    soa_iterator(Vector* vector, size_t index) : vector(vector), index(index) {}
+    // An iterator converts to a const_iterator
+    template <typename V, typename R> soa_iterator(const soa_iterator<V, R>& other) : vector(other.vector), index(other.index) {}
+
+    Reference operator*() const { return (*vector)[index]; }
+    Reference operator[](difference_type offset) const { return (*vector)[index + offset]; }
+    soa_iterator& operator++() { index++; return *this; }
+    soa_iterator operator++(int) { soa_iterator old = *this; index++; return old; }
+    soa_iterator& operator--() { index--; return *this; }
+    soa_iterator operator--(int) { soa_iterator old = *this; index--; return old; }
+    soa_iterator& operator+=(difference_type offset) { index += offset; return *this; }
+    soa_iterator& operator-=(difference_type offset) { index -= offset; return *this; }
+    soa_iterator operator+(difference_type offset) const { return soa_iterator(vector, index + offset); }
+    soa_iterator operator-(difference_type offset) const { return soa_iterator(vector, index - offset); }
+    difference_type operator-(const soa_iterator& other) const { return (difference_type)index - (difference_type)other.index; }
+    bool operator==(const soa_iterator& other) const { return index == other.index; }
+    bool operator!=(const soa_iterator& other) const { return index != other.index; }
+    bool operator<(const soa_iterator& other) const { return index < other.index; }
+
+    Vector* vector;
+    size_t index;
+};
+
+// The columns of a soa_vector in one allocation, one per member pointer.
+// Generated soa_vector specializations derive from this and add the named
+// column accessors and the element proxies.
+template <typename T, auto... Members> class soa_storage {
+public:
+    typedef T value_type;
+    typedef size_t size_type;
+    static constexpr size_t column_count = sizeof...(Members);
+    template <size_t I> using column_type = typename std::tuple_element<I, std::tuple<typename detail::member_type<decltype(Members)>::type...>>::type;
+    // Columns start at multiples of this
+    static constexpr size_t column_alignment = 64;
+
+    soa_storage() : block(0), count(0), reserved(0) {
+        for (void*& column : columns)
+            column = 0;
+    }
+    soa_storage(const soa_storage& other) : soa_storage() {
+        reserve(other.count);
+        each_column([&](auto I) {
+            for (size_t i = 0; i < other.count; i++)
+                detail::soa_construct(column<I>() + i, other.template column<I>()[i]);
+        });
+        count = other.count;
+    }
+    soa_storage(soa_storage&& other) : soa_storage() { swap(other); }
+    soa_storage& operator=(soa_storage other) {
+        swap(other);
+        return *this;
+    }
+    ~soa_storage() {
+        clear();
+        release(block);
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return reserved; }
+    bool empty() const { return count == 0; }
+
+    template <size_t I> column_type<I>* column() { return static_cast<column_type<I>*>(columns[I]); }
+    template <size_t I> const column_type<I>* column() const { return static_cast<const column_type<I>*>(columns[I]); }
+
+    void reserve(size_t capacity) {
+        if (capacity > reserved)
+            reallocate(capacity);
+    }
+    void shrink_to_fit() {
+        if (count < reserved)
+            reallocate(count);
+    }
+    void clear() {
+        each_column([&](auto I) {
+            for (size_t i = 0; i < count; i++)
+                detail::soa_destroy(column<I>() + i);
+        });
+        count = 0;
+    }
+    void push_back(const T& value) {
+        grow();
+        each_column([&](auto I) { detail::soa_construct(column<I>() + count, value.*member<I>()); });
+        count++;
+    }
+    void push_back(T&& value) {
+        grow();
+        each_column([&](auto I) { detail::soa_construct(column<I>() + count, std::move(value.*member<I>())); });
+        count++;
+    }
+    void pop_back() {
+        count--;
+        each_column([&](auto I) { detail::soa_destroy(column<I>() + count); });
+    }
+    void resize(size_t size) {
+        while (count > size)
+            pop_back();
+        reserve(size);
+        for (; count < size; count++)
+            each_column([&](auto I) { detail::soa_construct(column<I>() + count); });
+    }
+    // Removes [first, last) keeping the order of the rest, like
+    // std::vector::erase
+    void erase_at(size_t first, size_t last) {
+        size_t removed = last - first;
+        each_column([&](auto I) {
+            column_type<I>* data = column<I>();
+            for (size_t i = first; i + removed < count; i++)
+                detail::soa_assign(data[i], std::move(data[i + removed]));
+            for (size_t i = count - removed; i < count; i++)
+                detail::soa_destroy(data + i);
+        });
+        count -= removed;
+    }
+    void erase_at(size_t index) { erase_at(index, index + 1); }
+    // Moves the last element into index instead of shifting everything after
+    // it
+    void swap_erase_at(size_t index) {
+        each_column([&](auto I) {
+            column_type<I>* data = column<I>();
+            if (index + 1 != count)
+                detail::soa_assign(data[index], std::move(data[count - 1]));
+            detail::soa_destroy(data + count - 1);
+        });
+        count--;
+    }
+
+    T get(size_t index) const {
+        T value = {};
+        each_column([&](auto I) { detail::soa_assign(value.*member<I>(), column<I>()[index]); });
+        return value;
+    }
+    void set(size_t index, const T& value) {
+        each_column([&](auto I) { detail::soa_assign(column<I>()[index], value.*member<I>()); });
+    }
+
+    void swap(soa_storage& other) {
+        std::swap(block, other.block);
+        std::swap(count, other.count);
+        std::swap(reserved, other.reserved);
+        for (size_t i = 0; i < column_count; i++)
+            std::swap(columns[i], other.columns[i]);
+    }
+
+private:
+    template <size_t I> static constexpr auto member() { return std::get<I>(std::make_tuple(Members...)); }
+
+    template <typename Function, size_t... I> static void each_column(Function&& function, std::index_sequence<I...>) {
+        (function(std::integral_constant<size_t, I>()), ...);
+    }
+    template <typename Function> static void each_column(Function&& function) {
+        each_column(function, std::make_index_sequence<column_count>());
+    }
+
+    static void release(void* memory) {
+        if (memory)
+            ::operator delete(memory, std::align_val_t(column_alignment));
+    }
+
+    void grow() {
+        if (count == reserved)
+            reallocate(reserved ? reserved * 2 : 16);
+    }
+
+    void reallocate(size_t capacity) {
+        size_t offsets[column_count > 0 ? column_count : 1];
+        size_t total = 0;
+        each_column([&](auto I) {
+            offsets[I] = total;
+            total += (capacity * sizeof(column_type<I>) + column_alignment - 1) & ~(column_alignment - 1);
+        });
+        void* moved = total ? ::operator new(total, std::align_val_t(column_alignment)) : 0;
+        each_column([&](auto I) {
+            column_type<I>* to = reinterpret_cast<column_type<I>*>(static_cast<char*>(moved) + offsets[I]);
+            for (size_t i = 0; i < count; i++) {
+                detail::soa_construct(to + i, std::move(column<I>()[i]));
+                detail::soa_destroy(column<I>() + i);
+            }
+            columns[I] = to;
+        });
+        release(block);
+        block = moved;
+        reserved = capacity;
+    }
+
+    void* block;
+    void* columns[column_count > 0 ? column_count : 1];
+    size_t count;
+    size_t reserved;
+};
+
+} // namespace prx
@@ -0,0 +1,209 @@
+// Unity batches: several headers are parsed as one synthetic TU that includes
+// them all, so the heavy headers they have in common are parsed once per
+// batch rather than once per header. Declarations are attributed back to the
+// header they come from by file location.
+//
+// Headers are only combined when that can't change their meaning. Headers
+// that define or undefine a macro some other input also defines, or that test
+// a macro another input defines, are always parsed alone. Only headers of the
+// same extension are combined, the synthetic TU takes it so clang picks the
+// same language. A batch whose parse reports errors or macro redefinitions
+// falls back to parsing each member alone.
+
+#include <unordered_map>
+
+// Identifiers in the expression of an #if or #elif, which are the macros it
+// tests, up to a comment
+static void CollectConditionMacros(const std::string& source, size_t i, size_t end, std::vector<std::string>* names) {
+    while (i < end) {
+        if (source[i] == '/' && i + 1 < end && (source[i + 1] == '/' || source[i + 1] == '*'))
+            return;
+        if (!IsIdentifierChar(source[i])) {
+            i++;
+            continue;
+        }
+        size_t name = i;
+        while (i < end && IsIdentifierChar(source[i]))
+            i++;
+        // Numbers, with their suffixes, aren't names
+        if (source[name] >= '0' && source[name] <= '9')
+            continue;
+        std::string macro = source.substr(name, i - name);
+        if (macro != "defined")
+            names->push_back(macro);
+    }
+}
+
+// Names of macros a header #defines or #undefs, and of those it tests with
+// #if, #ifdef and the like, without its include guard. This is a line-based
+// scan, not a preprocessor, which is plenty for telling whether two headers
+// may step on each other.
+void CollectDefinedMacros(const std::string& source, std::vector<std::string>* names, std::vector<std::string>* tested) {
+    std::string guard;
+    bool firstDirective = true;
+    size_t at = 0;
+    while (at < source.size()) {
+        size_t end = source.find('\n', at);
+        if (end == std::string::npos)
+            end = source.size();
+        size_t i = at;
+        at = end + 1;
+        while (i < end && (source[i] == ' ' || source[i] == '\t'))
+            i++;
+        if (i >= end || source[i] != '#')
+            continue;
+        i++;
+        while (i < end && (source[i] == ' ' || source[i] == '\t'))
+            i++;
+        size_t keyword = i;
+        while (i < end && IsIdentifierChar(source[i]))
+            i++;
+        std::string directive = source.substr(keyword, i - keyword);
+        while (i < end && (source[i] == ' ' || source[i] == '\t'))
+            i++;
+        size_t name = i;
+        while (i < end && IsIdentifierChar(source[i]))
+            i++;
+        std::string macro = source.substr(name, i - name);
+
+        if (firstDirective && directive == "ifndef")
+            guard = macro;
+        firstDirective = false;
+        if ((directive == "define" || directive == "undef") && !macro.empty() && macro != guard)
+            names->push_back(macro);
+        if ((directive == "ifdef" || directive == "ifndef" || directive == "elifdef" || directive == "elifndef") && !macro.empty() && macro != guard)
+            tested->push_back(macro);
+        if (directive == "if" || directive == "elif")
+            CollectConditionMacros(source, name, end, tested);
+    }
+}
+
+// The extension of an input, which the synthetic TU of its batch takes
+static std::string BatchExtension(const std::string& input) {
+    return std::filesystem::path(input).extension().string();
+}
+
+// Splits the pending inputs into scan items: single TUs and batches of up to
+// batchSize headers that are safe to combine. Input order is kept within
+// batches so the output doesn't depend on the batch size.
+std::vector<std::vector<size_t>> PlanScanItems(const ScanOptions& options, const std::vector<size_t>& pending, u32* soloCount) {
+    std::vector<bool> solo(options.inputs.size(), false);
+    std::vector<std::vector<std::string>> tested(options.inputs.size());
+    std::unordered_map<std::string, size_t> definedBy;
+    for (size_t i : pending) {
+        std::string source;
+        if (!LoadSource(options.buffers, options.inputs[i], &source)) {
+            solo[i] = true;
+            continue;
+        }
+        std::vector<std::string> macros;
+        CollectDefinedMacros(source, &macros, &tested[i]);
+        for (const std::string& macro : macros) {
+            auto inserted = definedBy.emplace(macro, i);
+            if (!inserted.second && inserted.first->second != i) {
+                solo[i] = true;
+                solo[inserted.first->second] = true;
+            }
+        }
+    }
+    // A header testing a macro would see it defined by a header included
+    // before it in the batch
+    for (size_t i : pending) {
+        for (const std::string& macro : tested[i]) {
+            auto it = definedBy.find(macro);
+            if (it != definedBy.end() && it->second != i)
+                solo[i] = true;
+        }
+    }
+
+    std::vector<std::vector<size_t>> items;
+    // The batch being filled for each extension
+    std::vector<std::pair<std::string, std::vector<size_t>>> batches;
+    *soloCount = 0;
+    for (size_t i : pending) {
+        if (solo[i]) {
+            (*soloCount)++;
+            items.push_back({ i });
+            continue;
+        }
+        std::string extension = BatchExtension(options.inputs[i]);
+        size_t b = 0;
+        while (b < batches.size() && batches[b].first != extension)
+            b++;
+        if (b == batches.size())
+            batches.push_back({ extension, {} });
+        std::vector<size_t>& batch = batches[b].second;
+        batch.push_back(i);
+        if (batch.size() == options.batchSize) {
+            items.push_back(std::move(batch));
+            batch.clear();
+        }
+    }
+    for (auto& batch : batches) {
+        if (!batch.second.empty())
+            items.push_back(std::move(batch.second));
+    }
+    return items;
+}
+
+static bool IsBatchSafe(CXTranslationUnit tu) {
+    bool safe = true;
+    unsigned count = clang_getNumDiagnostics(tu);
+    for (unsigned i = 0; i < count && safe; i++) {
+        CXDiagnostic diagnostic = clang_getDiagnostic(tu, i);
+        if (clang_getDiagnosticSeverity(diagnostic) >= CXDiagnostic_Error)
+            safe = false;
+        else if (ToString(clang_getDiagnosticOption(diagnostic, 0)) == "-Wmacro-redefined")
+            safe = false;
+        clang_disposeDiagnostic(diagnostic);
+    }
+    return safe;
+}
+
+static bool ScanBatchOnce(ScanContext* context, ScanWorker* worker, const std::vector<size_t>& members, std::vector<Database>* results) {
+    const ScanOptions& options = *context->options;
+    std::string batchPath = MakeTempPath("scan-batch", (u32)members[0]) + BatchExtension(options.inputs[members[0]]);
+    std::string batchSource;
+    std::vector<ExtractTarget> targets;
+    for (size_t member : members) {
+        std::string path = AbsolutePath(options.inputs[member]);
+        batchSource += "#include \"" + path + "\"\n";
+        targets.push_back({ path, &(*results)[member] });
+    }
+    CXUnsavedFile batchFile = { batchPath.c_str(), batchSource.data(), (unsigned long)batchSource.size() };
+    // The index backend can't take unsaved files, the batch TU goes on disk
+    bool onDisk = options.indexBackend && context->unsavedFiles.empty();
+    if (onDisk && !WriteEntireFile(batchPath.c_str(), batchSource.data(), batchSource.size()))
+        return false;
+
+    context->budget.Acquire();
+    CXTranslationUnit tu;
+    CXErrorCode error = ParseAndExtract(context, worker, batchPath, false, targets.data(), targets.size(), &tu, onDisk ? 0 : &batchFile);
+    if (onDisk)
+        RemoveFile(batchPath.c_str());
+    if (error != CXError_Success || !tu) {
+        if (tu)
+            clang_disposeTranslationUnit(tu);
+        context->budget.Release(0, batchPath);
+        return false;
+    }
+    // An unsafe batch has already been extracted into the results, the
+    // fallback below starts them over
+    bool safe = IsBatchSafe(tu);
+    DisposeTranslationUnit(context, tu, batchPath);
+    return safe;
+}
+
+void ScanBatch(ScanContext* context, ScanWorker* worker, const std::vector<size_t>& members, std::vector<Database>* results, std::vector<ScanStatus>* statuses) {
+    context->stats.batches++;
+    if (ScanBatchOnce(context, worker, members, results)) {
+        for (size_t member : members)
+            (*statuses)[member] = ScanStatus::Ok;
+        return;
+    }
+    context->stats.batchFallbacks++;
+    for (size_t member : members) {
+        (*results)[member] = Database();
+        (*statuses)[member] = ScanInProcess(context, worker, context->options->inputs[member], &(*results)[member]);
+    }
+}
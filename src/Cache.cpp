@@ -0,0 +1,58 @@
+// State kept between scans in the --cache file, keyed by input path. An entry
+// is only trusted while the file's size and modification time match.
+
+#include <unordered_map>
+
+struct CacheEntry {
+    u64 size;
+    u64 modifyTime;
+    // Hash of the marker set the decision below was made for
+    u64 markersHash;
+    bool hasMarkers;
+};
+
+struct ScanCache {
+    std::unordered_map<std::string, CacheEntry> entries;
+    bool dirty;
+};
+
+static const u32 CacheMagic = 0x43535850; // 'PXSC'
+static const u32 CacheVersion = 1;
+
+bool ReadScanCache(const char* path, ScanCache* cache) {
+    std::vector<u8> bytes;
+    if (!ReadEntireFile(path, &bytes))
+        return false;
+    BinaryReader reader(bytes.data(), bytes.size());
+    if (reader.U32() != CacheMagic || reader.U32() != CacheVersion)
+        return false;
+    u32 count = reader.U32();
+    for (u32 i = 0; i < count && reader.ok; i++) {
+        std::string input = reader.String();
+        CacheEntry entry;
+        entry.size = reader.U64();
+        entry.modifyTime = reader.U64();
+        entry.markersHash = reader.U64();
+        entry.hasMarkers = reader.U32() != 0;
+        cache->entries[input] = entry;
+    }
+    if (!reader.ok)
+        cache->entries.clear();
+    return reader.ok;
+}
+
+bool WriteScanCache(const char* path, const ScanCache& cache) {
+    BinaryWriter writer;
+    writer.U32(CacheMagic);
+    writer.U32(CacheVersion);
+    writer.U32((u32)cache.entries.size());
+    for (const auto& it : cache.entries) {
+        writer.String(it.first);
+        writer.U64(it.second.size);
+        writer.U64(it.second.modifyTime);
+        writer.U64(it.second.markersHash);
+        writer.U32(it.second.hasMarkers ? 1 : 0);
+    }
+    // Concurrent scans sharing a cache must never read a half-written file
+    return WriteFileAtomic(path, writer.bytes.data(), writer.bytes.size());
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t i32;
+typedef int64_t i64;
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#define Assert(expr) do { if (!(expr)) { fprintf(stderr, "Assertion failed: %s (%s:%d)\n", #expr, __FILE__, __LINE__); abort(); } } while (false)
+
+// FNV-1a, used for cache keys and content hashes
+inline u64 HashBytes(const void* data, size_t size, u64 hash = 0xcbf29ce484222325ull) {
+    const u8* bytes = (const u8*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+inline u64 HashString(const std::string& string, u64 hash = 0xcbf29ce484222325ull) {
+    // Mix in the length so that consecutive strings can't alias
+    u64 size = string.size();
+    hash = HashBytes(&size, sizeof(size), hash);
+    return HashBytes(string.data(), string.size(), hash);
+}
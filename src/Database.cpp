@@ -0,0 +1,760 @@
+// Reflection database produced by a scan. Worker processes hand their
+// results back to the parent through the same binary format that -o writes.
+//
+// The file is split into sections. The hot section has what a program looks
+// up at run time: names, types, offsets, signatures. Source locations and doc
+// comments are only for tools and live in cold sections after it, which a
+// reader loads on first use and --strip-cold leaves out.
+
+#include <unordered_map>
+#include <unordered_set>
+
+enum struct TypeKind : u32 {
+    Record,
+    Enum,
+};
+
+// Plain text of a declaration's doc comment, and its brief summary
+struct DocComment {
+    std::string brief;
+    std::string text;
+};
+
+enum FieldFlags : u32 {
+    FieldPublic = 1 << 0,
+    // Integers, enums and pointers, or arrays of them: two values are equal
+    // exactly when their bytes are
+    FieldBitwise = 1 << 1,
+};
+
+struct FieldInfo {
+    std::string name;
+    // As written, and canonical: the name of the field's type in the database
+    // when it is reflected
+    std::string type;
+    std::string canonicalType;
+    u64 offset;
+    u64 size;
+    u32 flags;
+    std::vector<std::string> annotations;
+    DocComment doc;
+};
+
+struct ParamInfo {
+    std::string name;
+    // Canonical and fully qualified, so generated code can spell it anywhere
+    std::string type;
+};
+
+enum FunctionFlags : u32 {
+    FunctionStatic = 1 << 0,
+    FunctionConst = 1 << 1,
+    FunctionVirtual = 1 << 2,
+    // Qualified &&, callable on rvalues only
+    FunctionRValue = 1 << 3,
+};
+
+// A free function or a method. Free functions are named fully qualified,
+// methods by their plain name.
+struct FunctionInfo {
+    std::string name;
+    std::string file;
+    u32 line;
+    std::string returnType;
+    std::vector<ParamInfo> params;
+    u32 flags;
+    std::string callingConvention;
+    // Linker symbol, empty when clang can't mangle the declaration
+    std::string mangledName;
+    std::vector<std::string> annotations;
+    DocComment doc;
+};
+
+// A variable with static storage: a free variable or a static data member.
+// Named like FunctionInfo.
+struct VariableInfo {
+    std::string name;
+    std::string file;
+    u32 line;
+    std::string type;
+    std::string mangledName;
+    std::vector<std::string> annotations;
+    DocComment doc;
+};
+
+enum struct ConstantKind : u32 {
+    Int,
+    UInt,
+    Float,
+    String,
+};
+
+// A const variable whose value clang could evaluate: constexpr variables and
+// static constexpr members. Named like FunctionInfo.
+struct ConstantInfo {
+    std::string name;
+    std::string file;
+    u32 line;
+    std::string type;
+    ConstantKind kind;
+    // Int and UInt, the bits of a u64 for UInt
+    i64 intValue;
+    f64 floatValue;
+    std::string stringValue;
+    std::vector<std::string> annotations;
+    DocComment doc;
+};
+
+struct EnumeratorInfo {
+    std::string name;
+    // The bits of a u64 when the enum's underlying type is unsigned
+    i64 value;
+    DocComment doc;
+};
+
+struct TypeInfo {
+    // Fully qualified, as clang spells the type
+    std::string name;
+    TypeKind kind;
+    std::string file;
+    u32 line;
+    u64 size;
+    u64 align;
+    std::vector<std::string> annotations;
+    // Class template specializations only: the template, fully qualified, and
+    // the arguments, types canonical and values in decimal
+    std::string templateName;
+    std::vector<std::string> templateArgs;
+    std::vector<std::string> bases;
+    std::vector<FieldInfo> fields;
+    // Non-static data members that aren't in fields: bit-fields, PRX_NOREFLECT
+    // ones and those clang had no layout for
+    u32 hiddenFields;
+    std::vector<FunctionInfo> methods;
+    std::vector<VariableInfo> staticFields;
+    std::vector<ConstantInfo> constants;
+    // Enums only
+    std::string underlyingType;
+    bool underlyingUnsigned;
+    std::vector<EnumeratorInfo> enumerators;
+    DocComment doc;
+};
+
+enum struct SectionId : u32 {
+    Hot = 1,
+    Locations = 2,
+    Docs = 3,
+    Dependencies = 4,
+};
+
+struct DatabaseSection {
+    SectionId id;
+    u64 offset;
+    u64 size;
+};
+
+struct Database {
+    std::vector<TypeInfo> types;
+    std::vector<FunctionInfo> functions;
+    std::vector<VariableInfo> variables;
+    std::vector<ConstantInfo> constants;
+    // Absolute paths of the headers the scanned TUs included, for dependency
+    // files. Tooling only, they are stored in a cold section.
+    std::vector<std::string> dependencies;
+    // Index into types by name, kept by MergeDatabase
+    std::unordered_map<std::string, u32> typeIndex;
+    // Signatures of functions, overloads share a name
+    std::unordered_set<std::string> functionSet;
+    // Names of variables and constants
+    std::unordered_set<std::string> variableSet;
+    std::unordered_set<std::string> dependencySet;
+    // Cold sections of a database read from disk that LoadColdSections hasn't
+    // read yet; the file, locations, doc comments and dependencies are empty
+    // until then
+    std::string coldPath;
+    std::vector<DatabaseSection> coldSections;
+};
+
+static const u32 DatabaseMagic = 0x42445850; // 'PXDB'
+static const u32 DatabaseVersion = 12;
+
+struct BinaryWriter {
+    std::vector<u8> bytes;
+
+    void Bytes(const void* data, size_t size) {
+        const u8* begin = (const u8*)data;
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+    void U32(u32 value) { Bytes(&value, sizeof(value)); }
+    void I64(i64 value) { Bytes(&value, sizeof(value)); }
+    void U64(u64 value) { Bytes(&value, sizeof(value)); }
+    void F64(f64 value) { Bytes(&value, sizeof(value)); }
+    void String(const std::string& value) {
+        U32((u32)value.size());
+        Bytes(value.data(), value.size());
+    }
+};
+
+struct BinaryReader {
+    const u8* at;
+    const u8* end;
+    bool ok;
+
+    BinaryReader(const u8* data, size_t size) : at(data), end(data + size), ok(true) {}
+
+    void Bytes(void* data, size_t size) {
+        if (!ok || (size_t)(end - at) < size) {
+            ok = false;
+            memset(data, 0, size);
+            return;
+        }
+        memcpy(data, at, size);
+        at += size;
+    }
+    u32 U32() { u32 value; Bytes(&value, sizeof(value)); return value; }
+    i64 I64() { i64 value; Bytes(&value, sizeof(value)); return value; }
+    u64 U64() { u64 value; Bytes(&value, sizeof(value)); return value; }
+    f64 F64() { f64 value; Bytes(&value, sizeof(value)); return value; }
+    std::string String() {
+        u32 size = U32();
+        if (!ok || (size_t)(end - at) < size) {
+            ok = false;
+            return std::string();
+        }
+        std::string value((const char*)at, size);
+        at += size;
+        return value;
+    }
+};
+
+bool HasAnnotation(const std::vector<std::string>& annotations, const char* annotation) {
+    for (const std::string& it : annotations)
+        if (it == annotation)
+            return true;
+    return false;
+}
+
+std::string FunctionSignature(const FunctionInfo& function) {
+    std::string signature = function.name + "(";
+    for (size_t i = 0; i < function.params.size(); i++) {
+        if (i)
+            signature += ", ";
+        signature += function.params[i].type;
+    }
+    signature += ")";
+    if (function.flags & FunctionConst)
+        signature += " const";
+    if (function.flags & FunctionRValue)
+        signature += " &&";
+    return signature;
+}
+
+// A header included by several inputs is still reflected only through its own
+// TU, but the same input may appear twice; the first definition wins.
+void MergeDatabase(Database* into, const Database& from) {
+    for (const TypeInfo& type : from.types) {
+        if (into->typeIndex.emplace(type.name, (u32)into->types.size()).second)
+            into->types.push_back(type);
+    }
+    for (const FunctionInfo& function : from.functions) {
+        if (into->functionSet.insert(FunctionSignature(function)).second)
+            into->functions.push_back(function);
+    }
+    for (const VariableInfo& variable : from.variables) {
+        if (into->variableSet.insert(variable.name).second)
+            into->variables.push_back(variable);
+    }
+    for (const ConstantInfo& constant : from.constants) {
+        if (into->variableSet.insert(constant.name).second)
+            into->constants.push_back(constant);
+    }
+    for (const std::string& dependency : from.dependencies) {
+        if (into->dependencySet.insert(dependency).second)
+            into->dependencies.push_back(dependency);
+    }
+}
+
+static void WriteStrings(BinaryWriter* writer, const std::vector<std::string>& strings) {
+    writer->U32((u32)strings.size());
+    for (const std::string& string : strings)
+        writer->String(string);
+}
+
+static void ReadStrings(BinaryReader* reader, std::vector<std::string>* strings) {
+    u32 count = reader->U32();
+    for (u32 i = 0; i < count && reader->ok; i++)
+        strings->push_back(reader->String());
+}
+
+static void WriteFunctions(BinaryWriter* writer, const std::vector<FunctionInfo>& functions) {
+    writer->U32((u32)functions.size());
+    for (const FunctionInfo& function : functions) {
+        writer->String(function.name);
+        writer->String(function.returnType);
+        writer->U32((u32)function.params.size());
+        for (const ParamInfo& param : function.params) {
+            writer->String(param.name);
+            writer->String(param.type);
+        }
+        writer->U32(function.flags);
+        writer->String(function.callingConvention);
+        writer->String(function.mangledName);
+        WriteStrings(writer, function.annotations);
+    }
+}
+
+static void WriteVariables(BinaryWriter* writer, const std::vector<VariableInfo>& variables) {
+    writer->U32((u32)variables.size());
+    for (const VariableInfo& variable : variables) {
+        writer->String(variable.name);
+        writer->String(variable.type);
+        writer->String(variable.mangledName);
+        WriteStrings(writer, variable.annotations);
+    }
+}
+
+static void ReadVariables(BinaryReader* reader, std::vector<VariableInfo>* variables) {
+    u32 count = reader->U32();
+    for (u32 i = 0; i < count && reader->ok; i++) {
+        VariableInfo variable = {};
+        variable.name = reader->String();
+        variable.type = reader->String();
+        variable.mangledName = reader->String();
+        ReadStrings(reader, &variable.annotations);
+        variables->push_back(std::move(variable));
+    }
+}
+
+static void ReadFunctions(BinaryReader* reader, std::vector<FunctionInfo>* functions) {
+    u32 count = reader->U32();
+    for (u32 i = 0; i < count && reader->ok; i++) {
+        FunctionInfo function = {};
+        function.name = reader->String();
+        function.returnType = reader->String();
+        u32 paramCount = reader->U32();
+        for (u32 p = 0; p < paramCount && reader->ok; p++) {
+            ParamInfo param;
+            param.name = reader->String();
+            param.type = reader->String();
+            function.params.push_back(std::move(param));
+        }
+        function.flags = reader->U32();
+        function.callingConvention = reader->String();
+        function.mangledName = reader->String();
+        ReadStrings(reader, &function.annotations);
+        functions->push_back(std::move(function));
+    }
+}
+
+static void WriteConstants(BinaryWriter* writer, const std::vector<ConstantInfo>& constants) {
+    writer->U32((u32)constants.size());
+    for (const ConstantInfo& constant : constants) {
+        writer->String(constant.name);
+        writer->String(constant.type);
+        writer->U32((u32)constant.kind);
+        writer->I64(constant.intValue);
+        writer->F64(constant.floatValue);
+        writer->String(constant.stringValue);
+        WriteStrings(writer, constant.annotations);
+    }
+}
+
+static void ReadConstants(BinaryReader* reader, std::vector<ConstantInfo>* constants) {
+    u32 count = reader->U32();
+    for (u32 i = 0; i < count && reader->ok; i++) {
+        ConstantInfo constant = {};
+        constant.name = reader->String();
+        constant.type = reader->String();
+        constant.kind = (ConstantKind)reader->U32();
+        constant.intValue = reader->I64();
+        constant.floatValue = reader->F64();
+        constant.stringValue = reader->String();
+        ReadStrings(reader, &constant.annotations);
+        constants->push_back(std::move(constant));
+    }
+}
+
+static void SerializeHot(const Database& db, BinaryWriter* writer) {
+    writer->U32((u32)db.types.size());
+    for (const TypeInfo& type : db.types) {
+        writer->String(type.name);
+        writer->U32((u32)type.kind);
+        writer->U64(type.size);
+        writer->U64(type.align);
+        WriteStrings(writer, type.annotations);
+        writer->String(type.templateName);
+        WriteStrings(writer, type.templateArgs);
+        WriteStrings(writer, type.bases);
+        writer->U32((u32)type.fields.size());
+        for (const FieldInfo& field : type.fields) {
+            writer->String(field.name);
+            writer->String(field.type);
+            writer->String(field.canonicalType);
+            writer->U64(field.offset);
+            writer->U64(field.size);
+            writer->U32(field.flags);
+            WriteStrings(writer, field.annotations);
+        }
+        writer->U32(type.hiddenFields);
+        WriteFunctions(writer, type.methods);
+        WriteVariables(writer, type.staticFields);
+        WriteConstants(writer, type.constants);
+        writer->String(type.underlyingType);
+        writer->U32(type.underlyingUnsigned ? 1 : 0);
+        writer->U32((u32)type.enumerators.size());
+        for (const EnumeratorInfo& enumerator : type.enumerators) {
+            writer->String(enumerator.name);
+            writer->I64(enumerator.value);
+        }
+    }
+    WriteFunctions(writer, db.functions);
+    WriteVariables(writer, db.variables);
+    WriteConstants(writer, db.constants);
+}
+
+static bool DeserializeHot(BinaryReader* reader, Database* db) {
+    u32 typeCount = reader->U32();
+    for (u32 i = 0; i < typeCount && reader->ok; i++) {
+        TypeInfo type = {};
+        type.name = reader->String();
+        type.kind = (TypeKind)reader->U32();
+        type.size = reader->U64();
+        type.align = reader->U64();
+        ReadStrings(reader, &type.annotations);
+        type.templateName = reader->String();
+        ReadStrings(reader, &type.templateArgs);
+        ReadStrings(reader, &type.bases);
+        u32 fieldCount = reader->U32();
+        for (u32 f = 0; f < fieldCount && reader->ok; f++) {
+            FieldInfo field;
+            field.name = reader->String();
+            field.type = reader->String();
+            field.canonicalType = reader->String();
+            field.offset = reader->U64();
+            field.size = reader->U64();
+            field.flags = reader->U32();
+            ReadStrings(reader, &field.annotations);
+            type.fields.push_back(std::move(field));
+        }
+        type.hiddenFields = reader->U32();
+        ReadFunctions(reader, &type.methods);
+        ReadVariables(reader, &type.staticFields);
+        ReadConstants(reader, &type.constants);
+        type.underlyingType = reader->String();
+        type.underlyingUnsigned = reader->U32() != 0;
+        u32 enumeratorCount = reader->U32();
+        for (u32 e = 0; e < enumeratorCount && reader->ok; e++) {
+            EnumeratorInfo enumerator;
+            enumerator.name = reader->String();
+            enumerator.value = reader->I64();
+            type.enumerators.push_back(std::move(enumerator));
+        }
+        db->typeIndex[type.name] = (u32)db->types.size();
+        db->types.push_back(std::move(type));
+    }
+    ReadFunctions(reader, &db->functions);
+    for (const FunctionInfo& function : db->functions)
+        db->functionSet.insert(FunctionSignature(function));
+    ReadVariables(reader, &db->variables);
+    for (const VariableInfo& variable : db->variables)
+        db->variableSet.insert(variable.name);
+    ReadConstants(reader, &db->constants);
+    for (const ConstantInfo& constant : db->constants)
+        db->variableSet.insert(constant.name);
+    return reader->ok;
+}
+
+// The cold sections hold no names: their records follow the order in which
+// the hot section stores the declarations, and these visit them in that order.
+template <typename Db, typename Visit> static void VisitLocations(Db* db, Visit visit) {
+    for (auto& type : db->types) {
+        visit(type.file, type.line);
+        for (auto& method : type.methods)
+            visit(method.file, method.line);
+        for (auto& field : type.staticFields)
+            visit(field.file, field.line);
+        for (auto& constant : type.constants)
+            visit(constant.file, constant.line);
+    }
+    for (auto& function : db->functions)
+        visit(function.file, function.line);
+    for (auto& variable : db->variables)
+        visit(variable.file, variable.line);
+    for (auto& constant : db->constants)
+        visit(constant.file, constant.line);
+}
+
+template <typename Db, typename Visit> static void VisitDocs(Db* db, Visit visit) {
+    for (auto& type : db->types) {
+        visit(type.doc);
+        for (auto& field : type.fields)
+            visit(field.doc);
+        for (auto& method : type.methods)
+            visit(method.doc);
+        for (auto& field : type.staticFields)
+            visit(field.doc);
+        for (auto& constant : type.constants)
+            visit(constant.doc);
+        for (auto& enumerator : type.enumerators)
+            visit(enumerator.doc);
+    }
+    for (auto& function : db->functions)
+        visit(function.doc);
+    for (auto& variable : db->variables)
+        visit(variable.doc);
+    for (auto& constant : db->constants)
+        visit(constant.doc);
+}
+
+// File paths are stored once, locations refer to them by index
+static void SerializeLocations(const Database& db, BinaryWriter* writer) {
+    std::unordered_map<std::string, u32> fileIndex;
+    std::vector<std::string> files;
+    BinaryWriter records;
+    VisitLocations(&db, [&](const std::string& file, u32 line) {
+        auto inserted = fileIndex.emplace(file, (u32)files.size());
+        if (inserted.second)
+            files.push_back(file);
+        records.U32(inserted.first->second);
+        records.U32(line);
+    });
+    WriteStrings(writer, files);
+    writer->Bytes(records.bytes.data(), records.bytes.size());
+}
+
+static bool DeserializeLocations(BinaryReader* reader, Database* db) {
+    std::vector<std::string> files;
+    ReadStrings(reader, &files);
+    VisitLocations(db, [&](std::string& file, u32& line) {
+        u32 index = reader->U32();
+        line = reader->U32();
+        if (index < files.size())
+            file = files[index];
+        else
+            reader->ok = false;
+    });
+    return reader->ok;
+}
+
+static void SerializeDocs(const Database& db, BinaryWriter* writer) {
+    VisitDocs(&db, [&](const DocComment& doc) {
+        writer->String(doc.brief);
+        writer->String(doc.text);
+    });
+}
+
+static bool DeserializeDocs(BinaryReader* reader, Database* db) {
+    VisitDocs(db, [&](DocComment& doc) {
+        doc.brief = reader->String();
+        doc.text = reader->String();
+    });
+    return reader->ok;
+}
+
+static void SerializeDependencies(const Database& db, BinaryWriter* writer) {
+    WriteStrings(writer, db.dependencies);
+}
+
+static bool DeserializeDependencies(BinaryReader* reader, Database* db) {
+    ReadStrings(reader, &db->dependencies);
+    for (const std::string& dependency : db->dependencies)
+        db->dependencySet.insert(dependency);
+    return reader->ok;
+}
+
+// Magic, version and a table of sections, each an id, an offset from the
+// start of the file and a size, followed by the sections
+void SerializeDatabase(const Database& db, bool cold, BinaryWriter* writer) {
+    BinaryWriter sections[4];
+    SectionId ids[4] = { SectionId::Hot, SectionId::Locations, SectionId::Docs, SectionId::Dependencies };
+    SerializeHot(db, &sections[0]);
+    u32 count = 1;
+    if (cold) {
+        SerializeLocations(db, &sections[1]);
+        SerializeDocs(db, &sections[2]);
+        SerializeDependencies(db, &sections[3]);
+        count = 4;
+    }
+    writer->U32(DatabaseMagic);
+    writer->U32(DatabaseVersion);
+    writer->U32(count);
+    u64 offset = 3 * sizeof(u32) + count * (sizeof(u32) + 2 * sizeof(u64));
+    for (u32 i = 0; i < count; i++) {
+        writer->U32((u32)ids[i]);
+        writer->U64(offset);
+        writer->U64(sections[i].bytes.size());
+        offset += sections[i].bytes.size();
+    }
+    for (u32 i = 0; i < count; i++)
+        writer->Bytes(sections[i].bytes.data(), sections[i].bytes.size());
+}
+
+static bool DeserializeColdSection(const DatabaseSection& section, const u8* data, Database* db) {
+    BinaryReader reader(data, (size_t)section.size);
+    switch (section.id) {
+    case SectionId::Locations: return DeserializeLocations(&reader, db);
+    case SectionId::Docs: return DeserializeDocs(&reader, db);
+    case SectionId::Dependencies: return DeserializeDependencies(&reader, db);
+    default: return true;
+    }
+}
+
+// Reads the header and the section table, size is what's available of the
+// file
+static bool ReadSectionTable(const u8* data, size_t size, std::vector<DatabaseSection>* sections) {
+    BinaryReader reader(data, size);
+    if (reader.U32() != DatabaseMagic || reader.U32() != DatabaseVersion)
+        return false;
+    u32 count = reader.U32();
+    for (u32 i = 0; i < count && reader.ok; i++) {
+        DatabaseSection section;
+        section.id = (SectionId)reader.U32();
+        section.offset = reader.U64();
+        section.size = reader.U64();
+        sections->push_back(section);
+    }
+    return reader.ok;
+}
+
+bool WriteDatabase(const char* path, const Database& db, bool cold) {
+    BinaryWriter writer;
+    SerializeDatabase(db, cold, &writer);
+    return WriteFileIfChanged(path, writer.bytes.data(), writer.bytes.size());
+}
+
+// Fills in the locations, doc comments and dependencies of a database from
+// ReadDatabase. Does nothing the second time, or for a database with its
+// cold sections stripped, which keeps them empty.
+bool LoadColdSections(Database* db) {
+    bool ok = true;
+    for (const DatabaseSection& section : db->coldSections) {
+        std::vector<u8> bytes((size_t)section.size);
+        size_t read;
+        ok = ReadFileRange(db->coldPath.c_str(), section.offset, bytes.size(), bytes.data(), &read) && read == bytes.size() &&
+             DeserializeColdSection(section, bytes.data(), db);
+        if (!ok)
+            break;
+    }
+    db->coldSections.clear();
+    return ok;
+}
+
+// Reads only the hot section. The cold sections are left on disk for
+// LoadColdSections, unless cold asks for them right away.
+bool ReadDatabase(const char* path, Database* db, bool cold) {
+    // Enough for the header and a table of every section there is
+    u8 header[3 * sizeof(u32) + 8 * (sizeof(u32) + 2 * sizeof(u64))];
+    size_t headerSize;
+    std::vector<DatabaseSection> sections;
+    if (!ReadFileRange(path, 0, sizeof(header), header, &headerSize) || !ReadSectionTable(header, headerSize, &sections))
+        return false;
+    bool hasHot = false;
+    for (const DatabaseSection& section : sections) {
+        if (section.id != SectionId::Hot) {
+            db->coldSections.push_back(section);
+            continue;
+        }
+        std::vector<u8> bytes((size_t)section.size);
+        size_t read;
+        if (!ReadFileRange(path, section.offset, bytes.size(), bytes.data(), &read) || read != bytes.size())
+            return false;
+        BinaryReader reader(bytes.data(), bytes.size());
+        if (!DeserializeHot(&reader, db))
+            return false;
+        hasHot = true;
+    }
+    if (!hasHot)
+        return false;
+    db->coldPath = path;
+    return !cold || LoadColdSections(db);
+}
+
+static void DumpConstant(const ConstantInfo& constant, FILE* out) {
+    fprintf(out, "%s %s = ", constant.type.c_str(), constant.name.c_str());
+    switch (constant.kind) {
+    case ConstantKind::Int: fprintf(out, "%lld\n", (long long)constant.intValue); break;
+    case ConstantKind::UInt: fprintf(out, "%llu\n", (unsigned long long)constant.intValue); break;
+    case ConstantKind::Float: fprintf(out, "%.17g\n", constant.floatValue); break;
+    case ConstantKind::String: fprintf(out, "\"%s\"\n", constant.stringValue.c_str()); break;
+    }
+}
+
+static void DumpFunction(const FunctionInfo& function, const char* indent, FILE* out) {
+    fprintf(out, "%s%s%s%s %s", indent, (function.flags & FunctionStatic) ? "static " : "", (function.flags & FunctionVirtual) ? "virtual " : "",
+            function.returnType.c_str(), function.name.c_str());
+    fprintf(out, "(");
+    for (size_t i = 0; i < function.params.size(); i++)
+        fprintf(out, "%s%s %s", i ? ", " : "", function.params[i].type.c_str(), function.params[i].name.c_str());
+    fprintf(out, ")%s%s", (function.flags & FunctionConst) ? " const" : "", (function.flags & FunctionRValue) ? " &&" : "");
+    if (!function.callingConvention.empty())
+        fprintf(out, " %s", function.callingConvention.c_str());
+    fprintf(out, "\n");
+}
+
+// Nothing for a database with its cold sections stripped
+static std::string DumpLocation(const std::string& file, u32 line) {
+    if (file.empty())
+        return std::string();
+    return " (" + file + ":" + std::to_string(line) + ")";
+}
+
+// Brief comments go on a line of their own above what they document
+static void DumpBrief(const DocComment& doc, const char* indent, FILE* out) {
+    if (!doc.brief.empty())
+        fprintf(out, "%s// %s\n", indent, doc.brief.c_str());
+}
+
+void DumpDatabase(const Database& db, FILE* out) {
+    for (const TypeInfo& type : db.types) {
+        DumpBrief(type.doc, "", out);
+        if (type.kind == TypeKind::Enum) {
+            fprintf(out, "enum %s : %s%s\n", type.name.c_str(), type.underlyingType.c_str(), DumpLocation(type.file, type.line).c_str());
+            for (const EnumeratorInfo& enumerator : type.enumerators) {
+                DumpBrief(enumerator.doc, "    ", out);
+                if (type.underlyingUnsigned)
+                    fprintf(out, "    %s = %llu\n", enumerator.name.c_str(), (unsigned long long)enumerator.value);
+                else
+                    fprintf(out, "    %s = %lld\n", enumerator.name.c_str(), (long long)enumerator.value);
+            }
+            continue;
+        }
+        fprintf(out, "struct %s size %llu align %llu%s\n", type.name.c_str(),
+                (unsigned long long)type.size, (unsigned long long)type.align, DumpLocation(type.file, type.line).c_str());
+        for (const std::string& base : type.bases)
+            fprintf(out, "    : %s\n", base.c_str());
+        for (const FieldInfo& field : type.fields) {
+            DumpBrief(field.doc, "    ", out);
+            fprintf(out, "    %s %s offset %llu size %llu\n", field.type.c_str(), field.name.c_str(),
+                    (unsigned long long)field.offset, (unsigned long long)field.size);
+        }
+        if (type.hiddenFields)
+            fprintf(out, "    (fields not reflected: %u)\n", type.hiddenFields);
+        for (const VariableInfo& field : type.staticFields) {
+            DumpBrief(field.doc, "    ", out);
+            fprintf(out, "    static %s %s\n", field.type.c_str(), field.name.c_str());
+        }
+        for (const ConstantInfo& constant : type.constants) {
+            DumpBrief(constant.doc, "    ", out);
+            fprintf(out, "    static ");
+            DumpConstant(constant, out);
+        }
+        for (const FunctionInfo& method : type.methods) {
+            DumpBrief(method.doc, "    ", out);
+            DumpFunction(method, "    ", out);
+        }
+    }
+    for (const FunctionInfo& function : db.functions) {
+        DumpBrief(function.doc, "", out);
+        fprintf(out, "function%s ", DumpLocation(function.file, function.line).c_str());
+        DumpFunction(function, "", out);
+    }
+    for (const VariableInfo& variable : db.variables) {
+        DumpBrief(variable.doc, "", out);
+        fprintf(out, "variable%s %s %s\n", DumpLocation(variable.file, variable.line).c_str(), variable.type.c_str(), variable.name.c_str());
+    }
+    for (const ConstantInfo& constant : db.constants) {
+        DumpBrief(constant.doc, "", out);
+        fprintf(out, "constant%s ", DumpLocation(constant.file, constant.line).c_str());
+        DumpConstant(constant, out);
+    }
+}
@@ -0,0 +1,318 @@
+ScanWorker CreateScanWorker(const ScanOptions& options) {
+    ScanWorker worker = {};
+    worker.index = clang_createIndex(1, 1);
+    if (options.indexBackend)
+        worker.action = clang_IndexAction_create(worker.index);
+    return worker;
+}
+
+void DestroyScanWorker(ScanWorker* worker) {
+    if (worker->action)
+        clang_IndexAction_dispose(worker->action);
+    if (worker->index)
+        clang_disposeIndex(worker->index);
+    worker->index = 0;
+    worker->action = 0;
+}
+
+// Entry point of a child spawned by ScanIsolated. The parent owns retries,
+// so the worker makes a single attempt and reports failure via exit code.
+int RunWorker(const ScanOptions& options) {
+    if (options.inputs.size() != 1 || options.outputPath.empty()) {
+        fprintf(stderr, "scan: --worker expects one input and -o\n");
+        return 2;
+    }
+    clang_toggleCrashRecovery(1);
+    ScanContext context = {};
+    context.options = &options;
+    context.unsavedFiles = MakeUnsavedFiles(options.buffers);
+    ScanWorker worker = CreateScanWorker(options);
+    Database db;
+    bool ok = ScanOnce(&context, &worker, options.inputs[0], options.reduced, &db);
+    DestroyScanWorker(&worker);
+    if (!ok)
+        return 1;
+    return WriteDatabase(options.outputPath.c_str(), db, true) ? 0 : 1;
+}
+
+// Make escapes spaces and '#' in a rule, and '$' is written '$$'
+static void AppendMakePath(std::string* out, const std::string& path) {
+    for (char c : path) {
+        if (c == ' ' || c == '#')
+            *out += '\\';
+        else if (c == '$')
+            *out += '$';
+        *out += c;
+    }
+}
+
+// Writes '<outputs>: <inputs> <headers>', the format of clang -MD, which make
+// includes and ninja reads through depfile = ... with deps = gcc. Source
+// buffers exist only in memory, they are left out; mapped virtual paths are
+// listed as the real file behind them.
+static bool WriteDepfile(const ScanOptions& options, const Database& db) {
+    std::unordered_set<std::string> virtualPaths;
+    std::unordered_map<std::string, std::string> realPaths;
+    for (const SourceBuffer& buffer : options.buffers)
+        virtualPaths.insert(buffer.path);
+    for (const FileMapping& mapping : options.mappings)
+        realPaths[AbsolutePath(mapping.virtualPath)] = mapping.realPath;
+
+    std::vector<std::string> paths;
+    for (const std::string& input : options.inputs)
+        paths.push_back(AbsolutePath(input));
+    paths.insert(paths.end(), db.dependencies.begin(), db.dependencies.end());
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    std::string text;
+    if (!options.outputPath.empty())
+        AppendMakePath(&text, options.outputPath);
+    for (const std::string* output : { &options.generatePath, &options.generateHeaderPath }) {
+        if (output->empty())
+            continue;
+        if (!text.empty())
+            text += " ";
+        AppendMakePath(&text, *output);
+    }
+    text += ":";
+    for (const std::string& path : paths) {
+        if (virtualPaths.count(path))
+            continue;
+        auto real = realPaths.find(path);
+        text += " \\\n  ";
+        AppendMakePath(&text, real != realPaths.end() ? real->second : path);
+    }
+    text += "\n";
+    return WriteFileIfChanged(options.depfilePath.c_str(), text.data(), text.size());
+}
+
+// The dump shows locations and doc comments, so the cold sections are loaded
+// when the file still has them
+int DumpDatabaseFile(const ScanOptions& options) {
+    Database db;
+    if (!ReadDatabase(options.dumpPath.c_str(), &db, false) || !LoadColdSections(&db)) {
+        fprintf(stderr, "scan: failed to read %s\n", options.dumpPath.c_str());
+        return 1;
+    }
+    DumpDatabase(db, stdout);
+    return 0;
+}
+
+int RunScan(ScanOptions options) {
+    std::string overlayPath;
+    if (!options.mappings.empty()) {
+        overlayPath = MakeTempPath("scan-overlay", 0);
+        if (!WriteVirtualFileOverlay(overlayPath.c_str(), options.mappings)) {
+            fprintf(stderr, "scan: failed to write the virtual file overlay\n");
+            return 1;
+        }
+        options.clangArgs.push_back("-ivfsoverlay");
+        options.clangArgs.push_back(overlayPath);
+    }
+    // Isolated workers can't share our memory, they get the buffers as one
+    // bundle written up front
+    std::string buffersPath;
+    if (options.isolate && !options.buffers.empty()) {
+        buffersPath = MakeTempPath("scan-buffers", 0);
+        if (!WriteSourceBuffersFile(buffersPath.c_str(), options.buffers)) {
+            fprintf(stderr, "scan: failed to write source buffers for workers\n");
+            return 1;
+        }
+    }
+
+    size_t inputCount = options.inputs.size();
+    std::vector<Database> results(inputCount);
+    std::vector<ScanStatus> statuses(inputCount, ScanStatus::Failed);
+    f64 startTime = GetTimeSeconds();
+
+    ScanContext context = {};
+    context.options = &options;
+    context.unsavedFiles = MakeUnsavedFiles(options.buffers);
+    // The budget throttles in-process parses only; isolated workers are
+    // separate processes and are bounded by -j
+    context.budget.limit = options.isolate ? 0 : options.memoryBudget;
+
+    ScanCache cache = {};
+    if (!options.cachePath.empty())
+        ReadScanCache(options.cachePath.c_str(), &cache);
+
+    std::vector<size_t> pending;
+    PrefilterStats prefilter = {};
+    if (!options.markers.empty()) {
+        std::vector<bool> keep = PrefilterInputs(options, options.cachePath.empty() ? 0 : &cache, &prefilter);
+        for (size_t i = 0; i < inputCount; i++) {
+            if (keep[i])
+                pending.push_back(i);
+            else
+                statuses[i] = ScanStatus::Skipped;
+        }
+    } else {
+        for (size_t i = 0; i < inputCount; i++)
+            pending.push_back(i);
+    }
+
+    // Batches are for in-process parsing; an isolated worker that crashes
+    // should take down a single header, not a whole batch
+    std::vector<std::vector<size_t>> items;
+    u32 soloCount = 0;
+    if (options.batchSize > 1 && !options.isolate) {
+        items = PlanScanItems(options, pending, &soloCount);
+    } else {
+        for (size_t i : pending)
+            items.push_back({ i });
+    }
+    std::atomic<size_t> nextItem(0);
+
+    if (options.sharePreamble && !options.isolate) {
+        PreambleCache* preambles = &context.preambles;
+        preambles->persistent = !options.pchCacheDir.empty();
+        if (preambles->persistent) {
+            std::error_code error;
+            std::filesystem::create_directories(options.pchCacheDir, error);
+            preambles->directory = options.pchCacheDir;
+        } else {
+            // Named after the process, parallel scans don't share PCHs
+            std::error_code error;
+            preambles->directory = MakeTempPath("scan-pch", 0);
+            std::filesystem::create_directories(preambles->directory, error);
+        }
+        std::vector<std::string> pendingInputs;
+        for (size_t i : pending)
+            pendingInputs.push_back(options.inputs[i]);
+        PlanPreambles(preambles, pendingInputs, options.buffers, options.clangArgs);
+    }
+
+    // libclang recovers from most crashes inside parsing and reports them as
+    // CXError_Crashed; anything it can't catch needs --isolate
+    clang_toggleCrashRecovery(1);
+
+    auto work = [&]() {
+        ScanWorker worker = {};
+        if (!options.isolate)
+            worker = CreateScanWorker(options);
+        for (;;) {
+            size_t item = nextItem++;
+            if (item >= items.size())
+                break;
+            if (items[item].size() > 1) {
+                ScanBatch(&context, &worker, items[item], &results, &statuses);
+                continue;
+            }
+            size_t i = items[item][0];
+            if (options.isolate)
+                statuses[i] = ScanIsolated(options, buffersPath, options.inputs[i], (u32)i, &results[i]);
+            else
+                statuses[i] = ScanInProcess(&context, &worker, options.inputs[i], &results[i]);
+        }
+        context.stats.typeLookups += worker.types.lookups;
+        context.stats.typeHits += worker.types.hits;
+        DestroyScanWorker(&worker);
+    };
+
+    u32 threadCount = options.threadCount;
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = (u32)std::max<size_t>(1, std::min<size_t>(threadCount, items.size()));
+
+    std::vector<std::thread> threads;
+    for (u32 i = 1; i < threadCount; i++)
+        threads.emplace_back(work);
+    work();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    CleanupPreambles(&context.preambles);
+    if (!overlayPath.empty())
+        RemoveFile(overlayPath.c_str());
+    if (!buffersPath.empty())
+        RemoveFile(buffersPath.c_str());
+    if (cache.dirty && !WriteScanCache(options.cachePath.c_str(), cache))
+        fprintf(stderr, "scan: failed to write cache %s\n", options.cachePath.c_str());
+
+    Database db;
+    u32 failed = 0;
+    u32 retried = 0;
+    for (size_t i = 0; i < inputCount; i++) {
+        if (statuses[i] == ScanStatus::Failed) {
+            failed++;
+            continue;
+        }
+        if (statuses[i] == ScanStatus::Retried)
+            retried++;
+        MergeDatabase(&db, results[i]);
+    }
+
+    if (retried || failed) {
+        fprintf(stderr, "scan: %u of %zu translation units needed a retry, %u failed:\n", retried + failed, inputCount, failed);
+        for (size_t i = 0; i < inputCount; i++)
+            if (statuses[i] == ScanStatus::Failed)
+                fprintf(stderr, "    %s\n", options.inputs[i].c_str());
+    }
+
+    if (options.printStats) {
+        ScanStats* stats = &context.stats;
+        fprintf(stderr, "scan: %zu translation units in %.2fs on %u threads, %s backend\n", inputCount, GetTimeSeconds() - startTime, threadCount,
+                options.indexBackend ? "index" : "cursor");
+        if (!options.markers.empty()) {
+            f64 megabytes = (f64)prefilter.bytesScanned / (1 << 20);
+            fprintf(stderr, "scan: pre-filter scanned %u files, %.1f MB in %.3fs (%.0f MB/s), %u decisions from cache, %u parses avoided\n",
+                    prefilter.filesScanned, megabytes, prefilter.seconds, prefilter.seconds > 0 ? megabytes / prefilter.seconds : 0.0,
+                    prefilter.cached, prefilter.skipped);
+        }
+        if (stats->parsedTus) {
+            fprintf(stderr, "scan: AST memory per TU: avg %.1f MB, peak %.1f MB\n",
+                    (f64)stats->totalTuMemory / stats->parsedTus / (1 << 20), (f64)stats->peakTuMemory / (1 << 20));
+        }
+        if (stats->typeLookups) {
+            fprintf(stderr, "scan: type cache: %llu lookups, %.1f%% hits\n", (unsigned long long)stats->typeLookups,
+                    100.0 * (f64)stats->typeHits / (f64)stats->typeLookups);
+        }
+        if (stats->batches) {
+            fprintf(stderr, "scan: %llu batches of up to %u headers, %llu fell back to single parses, %u headers not batchable\n",
+                    (unsigned long long)stats->batches, options.batchSize, (unsigned long long)stats->batchFallbacks, soloCount);
+        }
+        PreambleCache* preambles = &context.preambles;
+        if (!preambles->preambles.empty()) {
+            fprintf(stderr, "scan: %zu shared preambles, %u built in %.2fs, %u unusable, %u TUs parsed with one\n",
+                    preambles->preambles.size(), preambles->builds, preambles->buildSeconds, preambles->failedBuilds, preambles->hits);
+        }
+        if (context.budget.limit) {
+            fprintf(stderr, "scan: memory budget %llu MB: at most %u parses in flight, %u waits for budget\n",
+                    (unsigned long long)(context.budget.limit >> 20), context.budget.maxInFlight, context.budget.waits);
+        }
+    }
+
+    if (options.includeProfile) {
+        if (options.isolate)
+            fprintf(stderr, "scan: no include profile for --isolate, the parses happen in worker processes\n");
+        else
+            PrintIncludeProfile(&context.profile, 30, stderr);
+    }
+
+    if (options.outputPath.empty() && options.generatePath.empty() && options.generateHeaderPath.empty()) {
+        DumpDatabase(db, stdout);
+    } else if (!options.outputPath.empty() && !WriteDatabase(options.outputPath.c_str(), db, !options.stripCold)) {
+        fprintf(stderr, "scan: failed to write %s\n", options.outputPath.c_str());
+        return 1;
+    }
+    if (!options.generatePath.empty()) {
+        std::string source = GenerateSource(db);
+        if (!WriteFileIfChanged(options.generatePath.c_str(), source.data(), source.size())) {
+            fprintf(stderr, "scan: failed to write %s\n", options.generatePath.c_str());
+            return 1;
+        }
+    }
+    if (!options.generateHeaderPath.empty()) {
+        std::string header = GenerateHeader(db);
+        if (!WriteFileIfChanged(options.generateHeaderPath.c_str(), header.data(), header.size())) {
+            fprintf(stderr, "scan: failed to write %s\n", options.generateHeaderPath.c_str());
+            return 1;
+        }
+    }
+    if (!options.depfilePath.empty() && !WriteDepfile(options, db)) {
+        fprintf(stderr, "scan: failed to write %s\n", options.depfilePath.c_str());
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
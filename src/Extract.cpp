@@ -0,0 +1,786 @@
+#include <deque>
+
+std::string ToString(CXString cxstring) {
+    const char* cstring = clang_getCString(cxstring);
+    std::string result = cstring ? cstring : "";
+    clang_disposeString(cxstring);
+    return result;
+}
+
+// A file whose declarations are reflected, with the database they go to. A
+// regular TU has one target, its main file; a batch TU has one per header.
+struct ExtractTarget {
+    std::string path;
+    Database* db;
+};
+
+// What extraction needs to know about a canonical type, worked out once per
+// distinct type in a TU. Records and enums are keyed by their declaration,
+// clang_hashCursor with clang_equalCursors to settle collisions; everything
+// else (builtins, pointers, arrays, qualified types) by spelling. The cache
+// belongs to a worker and is cleared for every TU, since types and cursors
+// don't outlive their TU.
+struct CachedType {
+    CXCursor declaration;
+    std::string spelling;
+    i64 size;
+    i64 align;
+    // ExtractSpecializations has looked at this type
+    bool walked;
+};
+
+struct TypeCache {
+    std::unordered_multimap<unsigned, u32> byDeclaration;
+    std::unordered_map<std::string, u32> bySpelling;
+    // A deque, so entries stay where they are as others are added
+    std::deque<CachedType> types;
+    u64 lookups;
+    u64 hits;
+
+    void Clear() {
+        byDeclaration.clear();
+        bySpelling.clear();
+        types.clear();
+    }
+
+    CachedType* Add(CXCursor declaration, std::string spelling, CXType type) {
+        types.push_back({ declaration, std::move(spelling), clang_Type_getSizeOf(type), clang_Type_getAlignOf(type), false });
+        return &types.back();
+    }
+
+    // type must be canonical. The result is valid until the cache is cleared.
+    CachedType* Get(CXType type) {
+        lookups++;
+        bool qualified = clang_isConstQualifiedType(type) || clang_isVolatileQualifiedType(type) || clang_isRestrictQualifiedType(type);
+        if (!qualified && (type.kind == CXType_Record || type.kind == CXType_Enum)) {
+            CXCursor declaration = clang_getTypeDeclaration(type);
+            unsigned hash = clang_hashCursor(declaration);
+            auto range = byDeclaration.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (clang_equalCursors(types[it->second].declaration, declaration)) {
+                    hits++;
+                    return &types[it->second];
+                }
+            }
+            byDeclaration.emplace(hash, (u32)types.size());
+            return Add(declaration, ToString(clang_getTypeSpelling(type)), type);
+        }
+        std::string spelling = ToString(clang_getTypeSpelling(type));
+        auto inserted = bySpelling.emplace(spelling, (u32)types.size());
+        if (!inserted.second) {
+            hits++;
+            return &types[inserted.first->second];
+        }
+        return Add(clang_getNullCursor(), std::move(spelling), type);
+    }
+};
+
+struct ExtractState {
+    TypeCache* types;
+    const ExtractTarget* targets;
+    std::vector<CXFile> files;
+    CXFile lastFile;
+    Database* lastDb;
+};
+
+static Database* FindTargetDatabase(ExtractState* state, CXSourceLocation location) {
+    if (state->files.size() == 1)
+        return clang_Location_isFromMainFile(location) ? state->targets[0].db : 0;
+    CXFile file;
+    clang_getFileLocation(location, &file, 0, 0, 0);
+    if (!file)
+        return 0;
+    if (file == state->lastFile)
+        return state->lastDb;
+    Database* db = 0;
+    for (size_t i = 0; i < state->files.size(); i++) {
+        if (state->files[i] && clang_File_isEqual(state->files[i], file)) {
+            db = state->targets[i].db;
+            break;
+        }
+    }
+    state->lastFile = file;
+    state->lastDb = db;
+    return db;
+}
+
+// Annotations come first among a declaration's children, after the template
+// parameters of a template, so the walk stops at the first child that is
+// neither.
+static enum CXChildVisitResult CollectAnnotations(CXCursor cursor, CXCursor, CXClientData data) {
+    std::vector<std::string>* annotations = (std::vector<std::string>*)data;
+    CXCursorKind kind = clang_getCursorKind(cursor);
+    if (kind == CXCursor_TemplateTypeParameter || kind == CXCursor_NonTypeTemplateParameter || kind == CXCursor_TemplateTemplateParameter)
+        return CXChildVisit_Continue;
+    if (!clang_isAttribute(kind))
+        return CXChildVisit_Break;
+    if (kind == CXCursor_AnnotateAttr)
+        annotations->push_back(ToString(clang_getCursorSpelling(cursor)));
+    return CXChildVisit_Continue;
+}
+
+std::vector<std::string> GetAnnotations(CXCursor cursor) {
+    std::vector<std::string> annotations;
+    if (clang_Cursor_hasAttrs(cursor))
+        clang_visitChildren(cursor, CollectAnnotations, &annotations);
+    return annotations;
+}
+
+// The attributes of a class template belong to its pattern, which
+// clang_Cursor_hasAttrs doesn't look at
+static std::vector<std::string> GetTemplateAnnotations(CXCursor cursor) {
+    std::vector<std::string> annotations;
+    clang_visitChildren(cursor, CollectAnnotations, &annotations);
+    return annotations;
+}
+
+static void AppendCommentWord(std::string* text, const std::string& word) {
+    if (!text->empty() && text->back() != '\n' && text->back() != ' ')
+        *text += ' ';
+    *text += word;
+}
+
+// Plain text of a parsed doc comment. Paragraphs go on lines of their own,
+// the lines within one are joined, and block commands like \param and \return
+// are spelled out in front of their paragraph.
+static void AppendCommentText(CXComment comment, std::string* text) {
+    CXCommentKind kind = clang_Comment_getKind(comment);
+    switch (kind) {
+    case CXComment_Text: {
+        std::string line = ToString(clang_TextComment_getText(comment));
+        size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos)
+            return;
+        AppendCommentWord(text, line.substr(begin, line.find_last_not_of(" \t") + 1 - begin));
+    } return;
+    case CXComment_InlineCommand:
+        for (unsigned i = 0; i < clang_InlineCommandComment_getNumArgs(comment); i++) {
+            AppendCommentWord(text, ToString(clang_InlineCommandComment_getArgText(comment, i)));
+        }
+        return;
+    case CXComment_VerbatimBlockLine:
+    case CXComment_VerbatimLine:
+        *text += ToString(kind == CXComment_VerbatimLine ? clang_VerbatimLineComment_getText(comment) : clang_VerbatimBlockLineComment_getText(comment));
+        *text += '\n';
+        return;
+    case CXComment_BlockCommand:
+        *text += "\\" + ToString(clang_BlockCommandComment_getCommandName(comment)) + " ";
+        break;
+    case CXComment_ParamCommand:
+        *text += "\\param " + ToString(clang_ParamCommandComment_getParamName(comment)) + " ";
+        break;
+    case CXComment_TParamCommand:
+        *text += "\\tparam " + ToString(clang_TParamCommandComment_getParamName(comment)) + " ";
+        break;
+    default:
+        break;
+    }
+    for (unsigned i = 0; i < clang_Comment_getNumChildren(comment); i++)
+        AppendCommentText(clang_Comment_getChild(comment, i), text);
+    if (kind == CXComment_Paragraph && !text->empty() && text->back() != '\n')
+        *text += '\n';
+}
+
+static void ExtractDoc(CXCursor cursor, DocComment* doc) {
+    CXComment comment = clang_Cursor_getParsedComment(cursor);
+    if (clang_Comment_getKind(comment) == CXComment_Null)
+        return;
+    AppendCommentText(comment, &doc->text);
+    while (!doc->text.empty() && (doc->text.back() == '\n' || doc->text.back() == ' '))
+        doc->text.pop_back();
+    doc->brief = ToString(clang_Cursor_getBriefCommentText(cursor));
+}
+
+// Location and doc comment
+static void SetDeclSource(TypeInfo* type, CXCursor cursor) {
+    CXFile file;
+    unsigned line;
+    clang_getFileLocation(clang_getCursorLocation(cursor), &file, &line, 0, 0);
+    type->file = ToString(clang_getFileName(file));
+    type->line = line;
+    ExtractDoc(cursor, &type->doc);
+}
+
+// The layout queries return a negative CXTypeLayoutError instead of a size,
+// alignment or offset when there is none to give
+static const char* LayoutErrorName(long long error) {
+    switch (error) {
+    case CXTypeLayoutError_Incomplete:
+        return "incomplete type";
+    case CXTypeLayoutError_Dependent:
+        return "dependent type";
+    case CXTypeLayoutError_NotConstantSize:
+        return "size not constant";
+    case CXTypeLayoutError_InvalidFieldName:
+        return "invalid field name";
+    default:
+        return "invalid type";
+    }
+}
+
+// What is left out of the database for lack of a layout
+static void ReportNoLayout(CXCursor cursor, const char* what, const std::string& name, long long error) {
+    CXFile file;
+    unsigned line;
+    clang_getFileLocation(clang_getCursorLocation(cursor), &file, &line, 0, 0);
+    fprintf(stderr, "scan: %s:%u: %s %s has no layout (%s), not reflected\n", ToString(clang_getFileName(file)).c_str(), line, what, name.c_str(),
+            LayoutErrorName(error));
+}
+
+// Namespaces and records the declaration is nested in, outermost first
+static std::string QualifiedName(CXCursor cursor) {
+    std::string name = ToString(clang_getCursorSpelling(cursor));
+    for (CXCursor parent = clang_getCursorSemanticParent(cursor); !clang_Cursor_isNull(parent) && !clang_isTranslationUnit(clang_getCursorKind(parent));
+         parent = clang_getCursorSemanticParent(parent)) {
+        std::string scope = ToString(clang_getCursorSpelling(parent));
+        // Anonymous and inline namespaces don't need to be spelled
+        if (scope.empty() || (clang_getCursorKind(parent) == CXCursor_Namespace && clang_Cursor_isInlineNamespace(parent)))
+            continue;
+        name = scope + "::" + name;
+    }
+    return name;
+}
+
+static const std::string& CanonicalSpelling(TypeCache* types, CXType type) {
+    return types->Get(clang_getCanonicalType(type))->spelling;
+}
+
+// Only conventions that differ from what the platform uses anyway are named
+static const char* CallingConventionName(CXCallingConv convention) {
+    switch (convention) {
+    case CXCallingConv_X86StdCall: return "stdcall";
+    case CXCallingConv_X86FastCall: return "fastcall";
+    case CXCallingConv_X86Pascal: return "pascal";
+    case CXCallingConv_X86RegCall: return "regcall";
+    case CXCallingConv_X86VectorCall: return "vectorcall";
+    case CXCallingConv_AAPCS_VFP: return "aapcs-vfp";
+    case CXCallingConv_AArch64VectorCall: return "aarch64-vectorcall";
+    default: return "";
+    }
+}
+
+// Skips whitespace and comments in text from at
+static size_t SkipBlank(const char* text, size_t size, size_t at) {
+    while (at < size) {
+        if (isspace((u8)text[at])) {
+            at++;
+        } else if (at + 1 < size && text[at] == '/' && text[at + 1] == '/') {
+            while (at < size && text[at] != '\n')
+                at++;
+        } else if (at + 1 < size && text[at] == '/' && text[at + 1] == '*') {
+            at += 2;
+            while (at + 1 < size && !(text[at] == '*' && text[at + 1] == '/'))
+                at++;
+            at += 2;
+        } else {
+            break;
+        }
+    }
+    return at;
+}
+
+// Skips whitespace and block comments in text backwards from at, to the
+// position after the last character that is neither
+static size_t SkipBlankBack(const char* text, size_t at) {
+    while (at > 0) {
+        if (isspace((u8)text[at - 1])) {
+            at--;
+        } else if (at >= 4 && text[at - 1] == '/' && text[at - 2] == '*') {
+            at -= 2;
+            while (at >= 2 && !(text[at - 2] == '/' && text[at - 1] == '*'))
+                at--;
+            at = at >= 2 ? at - 2 : 0;
+        } else {
+            break;
+        }
+    }
+    return at;
+}
+
+// Whether a function definition has a body, which a deleted one doesn't
+static enum CXChildVisitResult FindFunctionBody(CXCursor cursor, CXCursor, CXClientData data) {
+    CXCursorKind kind = clang_getCursorKind(cursor);
+    if (kind != CXCursor_CompoundStmt && kind != CXCursor_CXXTryStmt)
+        return CXChildVisit_Continue;
+    *(bool*)data = true;
+    return CXChildVisit_Break;
+}
+
+// Whether the declaration is "= delete". Older libclang has no query for
+// it, and none has one for free functions, so it is read off the source
+// around the end of the extent: the extent of a method ends with "= delete",
+// that of a free function stops right before it. Functions with a body are
+// never read.
+static bool IsDeletedFunction(CXCursor cursor) {
+#if CINDEX_VERSION_MINOR >= 63
+    if (clang_getCursorKind(cursor) == CXCursor_CXXMethod)
+        return clang_CXXMethod_isDeleted(cursor) != 0;
+#endif
+    // libclang doesn't count a deleted function as a definition
+    if (clang_isCursorDefinition(cursor)) {
+        bool body = false;
+        clang_visitChildren(cursor, FindFunctionBody, &body);
+        if (body)
+            return false;
+    }
+    CXFile file;
+    unsigned end;
+    clang_getExpansionLocation(clang_getRangeEnd(clang_getCursorExtent(cursor)), &file, 0, 0, &end);
+    size_t size;
+    const char* text = clang_getFileContents(clang_Cursor_getTranslationUnit(cursor), file, &size);
+    if (!text || end > size)
+        return false;
+    if (end >= 6 && memcmp(text + end - 6, "delete", 6) == 0 && (end == 6 || !IsIdentifierChar(text[end - 7]))) {
+        size_t at = SkipBlankBack(text, end - 6);
+        return at > 0 && text[at - 1] == '=';
+    }
+    size_t at = SkipBlank(text, size, end);
+    if (at >= size || text[at] != '=')
+        return false;
+    at = SkipBlank(text, size, at + 1);
+    return size - at >= 6 && memcmp(text + at, "delete", 6) == 0 && (at + 6 == size || !IsIdentifierChar(text[at + 6]));
+}
+
+// Variadic functions have no fixed signature to generate a thunk for and are
+// left out, deleted ones can't be called.
+static bool ExtractFunction(TypeCache* types, CXCursor cursor, std::vector<std::string> annotations, bool method, FunctionInfo* function) {
+    CXType type = clang_getCursorType(cursor);
+    if (clang_isFunctionTypeVariadic(type) || IsDeletedFunction(cursor))
+        return false;
+    int paramCount = clang_Cursor_getNumArguments(cursor);
+    if (paramCount < 0)
+        return false;
+    *function = {};
+    function->name = method ? ToString(clang_getCursorSpelling(cursor)) : QualifiedName(cursor);
+    CXFile file;
+    clang_getFileLocation(clang_getCursorLocation(cursor), &file, &function->line, 0, 0);
+    function->file = ToString(clang_getFileName(file));
+    ExtractDoc(cursor, &function->doc);
+    function->returnType = CanonicalSpelling(types, clang_getResultType(type));
+    for (int i = 0; i < paramCount; i++) {
+        ParamInfo param;
+        param.name = ToString(clang_getCursorSpelling(clang_Cursor_getArgument(cursor, (unsigned)i)));
+        param.type = CanonicalSpelling(types, clang_getArgType(type, (unsigned)i));
+        function->params.push_back(std::move(param));
+    }
+    if (method) {
+        if (clang_CXXMethod_isStatic(cursor))
+            function->flags |= FunctionStatic;
+        if (clang_CXXMethod_isConst(cursor))
+            function->flags |= FunctionConst;
+        if (clang_CXXMethod_isVirtual(cursor))
+            function->flags |= FunctionVirtual;
+        if (clang_Type_getCXXRefQualifier(type) == CXRefQualifier_RValue)
+            function->flags |= FunctionRValue;
+    }
+    function->callingConvention = CallingConventionName(clang_getFunctionTypeCallingConv(type));
+    function->mangledName = ToString(clang_Cursor_getMangling(cursor));
+    function->annotations = std::move(annotations);
+    return true;
+}
+
+static void ExtractVariable(TypeCache* types, CXCursor cursor, std::vector<std::string> annotations, bool member, VariableInfo* variable) {
+    *variable = {};
+    variable->name = member ? ToString(clang_getCursorSpelling(cursor)) : QualifiedName(cursor);
+    CXFile file;
+    clang_getFileLocation(clang_getCursorLocation(cursor), &file, &variable->line, 0, 0);
+    variable->file = ToString(clang_getFileName(file));
+    ExtractDoc(cursor, &variable->doc);
+    variable->type = CanonicalSpelling(types, clang_getCursorType(cursor));
+    variable->mangledName = ToString(clang_Cursor_getMangling(cursor));
+    variable->annotations = std::move(annotations);
+}
+
+// Const variables with an initializer clang can evaluate are constants, with
+// their value instead of a symbol
+static bool ExtractConstant(TypeCache* types, CXCursor cursor, const std::vector<std::string>& annotations, bool member, ConstantInfo* constant) {
+    CXType type = clang_getCursorType(cursor);
+    if (!clang_isConstQualifiedType(type))
+        return false;
+    CXEvalResult result = clang_Cursor_Evaluate(cursor);
+    if (!result)
+        return false;
+    bool ok = true;
+    *constant = {};
+    switch (clang_EvalResult_getKind(result)) {
+    case CXEval_Int:
+        if (clang_EvalResult_isUnsignedInt(result)) {
+            constant->kind = ConstantKind::UInt;
+            constant->intValue = (i64)clang_EvalResult_getAsUnsigned(result);
+        } else {
+            constant->kind = ConstantKind::Int;
+            constant->intValue = clang_EvalResult_getAsLongLong(result);
+        }
+        break;
+    case CXEval_Float:
+        constant->kind = ConstantKind::Float;
+        constant->floatValue = clang_EvalResult_getAsDouble(result);
+        break;
+    case CXEval_StrLiteral:
+        constant->kind = ConstantKind::String;
+        constant->stringValue = clang_EvalResult_getAsStr(result);
+        break;
+    default:
+        ok = false;
+        break;
+    }
+    clang_EvalResult_dispose(result);
+    if (!ok)
+        return false;
+    constant->name = member ? ToString(clang_getCursorSpelling(cursor)) : QualifiedName(cursor);
+    CXFile file;
+    clang_getFileLocation(clang_getCursorLocation(cursor), &file, &constant->line, 0, 0);
+    constant->file = ToString(clang_getFileName(file));
+    ExtractDoc(cursor, &constant->doc);
+    constant->type = CanonicalSpelling(types, type);
+    constant->annotations = annotations;
+    return true;
+}
+
+struct RecordState {
+    ExtractState* extract;
+    Database* db;
+    TypeInfo* type;
+};
+
+static enum CXChildVisitResult VisitDecl(CXCursor cursor, CXCursor, CXClientData data);
+static void ExtractSpecializations(RecordState* state, CXType type, CachedType* cached);
+
+// Floating point doesn't qualify, 0.0 and -0.0 compare equal
+static bool IsBitwiseComparable(CXType type) {
+    type = clang_getCanonicalType(type);
+    while (type.kind == CXType_ConstantArray)
+        type = clang_getCanonicalType(clang_getArrayElementType(type));
+    if (type.kind >= CXType_Bool && type.kind <= CXType_Int128)
+        return true;
+    return type.kind == CXType_Enum || type.kind == CXType_Pointer;
+}
+
+static enum CXVisitorResult ExtractField(CXCursor cursor, CXClientData data) {
+    RecordState* state = (RecordState*)data;
+    // Bit-fields have no byte offset and can't be pointed to
+    if (clang_Cursor_isBitField(cursor)) {
+        state->type->hiddenFields++;
+        return CXVisit_Continue;
+    }
+    FieldInfo field;
+    field.annotations = GetAnnotations(cursor);
+    if (HasAnnotation(field.annotations, "noreflect")) {
+        state->type->hiddenFields++;
+        return CXVisit_Continue;
+    }
+    // The spelling as written differs between typedefs of one type, so only
+    // the canonical spelling is cached
+    CXType type = clang_getCursorType(cursor);
+    CachedType* cached = state->extract->types->Get(clang_getCanonicalType(type));
+    field.name = ToString(clang_getCursorSpelling(cursor));
+    field.type = ToString(clang_getTypeSpelling(type));
+    field.canonicalType = cached->spelling;
+    long long offset = clang_Cursor_getOffsetOfField(cursor);
+    long long size = cached->size;
+    // A flexible array member takes no space
+    if (size < 0 && clang_getCanonicalType(type).kind == CXType_IncompleteArray)
+        size = 0;
+    if (offset < 0 || size < 0) {
+        ReportNoLayout(cursor, "field", field.name, offset < 0 ? offset : size);
+        state->type->hiddenFields++;
+        return CXVisit_Continue;
+    }
+    field.offset = (u64)offset / 8;
+    field.size = (u64)size;
+    field.flags = clang_getCXXAccessSpecifier(cursor) == CX_CXXPublic ? (u32)FieldPublic : 0;
+    if (IsBitwiseComparable(type))
+        field.flags |= FieldBitwise;
+    ExtractDoc(cursor, &field.doc);
+    state->type->fields.push_back(std::move(field));
+    ExtractSpecializations(state, type, cached);
+    return CXVisit_Continue;
+}
+
+// Class template specializations a reflected record holds by value, as a
+// field, a base, an array element or a template argument of one, are
+// reflected when their template is tagged. Implicit instantiations have no
+// children to walk, their fields come from clang_Type_visitFields. They are
+// named by canonical type, so all the aliases of one instantiation share an
+// entry. cached is the cache entry of type when the caller has it, so a type
+// counts as one lookup per occurrence in the --stats hit rate.
+static void ExtractSpecializations(RecordState* state, CXType type, CachedType* cached) {
+    TypeCache* types = state->extract->types;
+    type = clang_getCanonicalType(type);
+    while (type.kind == CXType_ConstantArray || type.kind == CXType_IncompleteArray) {
+        type = clang_getCanonicalType(clang_getArrayElementType(type));
+        cached = 0;
+    }
+    // Template arguments and everything below them are looked at once per type
+    if (!cached)
+        cached = types->Get(type);
+    if (cached->walked)
+        return;
+    cached->walked = true;
+    if (clang_Type_getNumTemplateArguments(type) < 0)
+        return;
+    CXCursor decl = clang_getTypeDeclaration(type);
+    int argCount = clang_Cursor_getNumTemplateArguments(decl);
+    std::vector<std::string> args;
+    for (int i = 0; i < argCount; i++) {
+        switch (clang_Cursor_getTemplateArgumentKind(decl, (unsigned)i)) {
+        case CXTemplateArgumentKind_Type: {
+            CXType arg = clang_Cursor_getTemplateArgumentType(decl, (unsigned)i);
+            CachedType* argCached = types->Get(clang_getCanonicalType(arg));
+            args.push_back(argCached->spelling);
+            ExtractSpecializations(state, arg, argCached);
+        } break;
+        case CXTemplateArgumentKind_Integral:
+            args.push_back(std::to_string(clang_Cursor_getTemplateArgumentValue(decl, (unsigned)i)));
+            break;
+        default:
+            args.push_back(std::string());
+            break;
+        }
+    }
+
+    CXCursor specialized = clang_getSpecializedCursorTemplate(decl);
+    if (clang_Cursor_isNull(specialized) || !clang_isCursorDefinition(decl))
+        return;
+    std::vector<std::string> annotations = GetTemplateAnnotations(specialized);
+    if (!HasAnnotation(annotations, "reflect"))
+        return;
+    if (cached->size < 0 || cached->align < 0) {
+        ReportNoLayout(decl, "type", cached->spelling, cached->size < 0 ? cached->size : cached->align);
+        return;
+    }
+
+    TypeInfo info = {};
+    info.name = cached->spelling;
+    info.kind = TypeKind::Record;
+    info.size = (u64)cached->size;
+    info.align = (u64)cached->align;
+    info.annotations = std::move(annotations);
+    info.templateName = QualifiedName(specialized);
+    info.templateArgs = std::move(args);
+    SetDeclSource(&info, decl);
+    Database nested;
+    RecordState recordState = { state->extract, &nested, &info };
+    clang_Type_visitFields(type, ExtractField, &recordState);
+    state->db->types.push_back(std::move(info));
+    for (TypeInfo& nestedType : nested.types)
+        state->db->types.push_back(std::move(nestedType));
+}
+
+static enum CXChildVisitResult VisitRecordMember(CXCursor cursor, CXCursor parent, CXClientData data) {
+    RecordState* state = (RecordState*)data;
+    switch (clang_getCursorKind(cursor)) {
+    case CXCursor_CXXBaseSpecifier: {
+        CXType type = clang_getCursorType(cursor);
+        CachedType* cached = state->extract->types->Get(clang_getCanonicalType(type));
+        state->type->bases.push_back(cached->spelling);
+        ExtractSpecializations(state, type, cached);
+    } break;
+    case CXCursor_FieldDecl:
+        ExtractField(cursor, state);
+        break;
+    case CXCursor_VarDecl: {
+        // Static data members, under the same rules as methods
+        if (clang_getCXXAccessSpecifier(cursor) != CX_CXXPublic)
+            break;
+        std::vector<std::string> annotations = GetAnnotations(cursor);
+        if (HasAnnotation(annotations, "noreflect"))
+            break;
+        ConstantInfo constant;
+        if (ExtractConstant(state->extract->types, cursor, annotations, true, &constant)) {
+            state->type->constants.push_back(std::move(constant));
+            break;
+        }
+        VariableInfo field;
+        ExtractVariable(state->extract->types, cursor, std::move(annotations), true, &field);
+        state->type->staticFields.push_back(std::move(field));
+    } break;
+    case CXCursor_CXXMethod: {
+        // Public methods of a reflected record are reflected unless opted out;
+        // thunks can't call the rest
+        if (clang_getCXXAccessSpecifier(cursor) != CX_CXXPublic)
+            break;
+        std::vector<std::string> annotations = GetAnnotations(cursor);
+        if (HasAnnotation(annotations, "noreflect"))
+            break;
+        FunctionInfo method;
+        if (ExtractFunction(state->extract->types, cursor, std::move(annotations), true, &method))
+            state->type->methods.push_back(std::move(method));
+    } break;
+    case CXCursor_StructDecl:
+    case CXCursor_ClassDecl:
+    case CXCursor_UnionDecl:
+    case CXCursor_EnumDecl:
+        // Nested types are opt-in on their own
+        VisitDecl(cursor, parent, state);
+        break;
+    default:
+        break;
+    }
+    return CXChildVisit_Continue;
+}
+
+static void ExtractRecord(RecordState* state, CXCursor cursor, std::vector<std::string> annotations) {
+    CXType type = clang_getCursorType(cursor);
+    TypeInfo info = {};
+    info.name = ToString(clang_getTypeSpelling(type));
+    long long size = clang_Type_getSizeOf(type);
+    long long align = clang_Type_getAlignOf(type);
+    // A record nested in a class template has none, for one
+    if (size < 0 || align < 0) {
+        ReportNoLayout(cursor, "type", info.name, size < 0 ? size : align);
+        return;
+    }
+    info.kind = TypeKind::Record;
+    info.size = (u64)size;
+    info.align = (u64)align;
+    info.annotations = std::move(annotations);
+    SetDeclSource(&info, cursor);
+
+    // Nested types go to their own list, appending to the database here could
+    // move info while it's being filled
+    Database nested;
+    RecordState recordState = { state->extract, &nested, &info };
+    clang_visitChildren(cursor, VisitRecordMember, &recordState);
+    state->db->types.push_back(std::move(info));
+    for (TypeInfo& nestedType : nested.types)
+        state->db->types.push_back(std::move(nestedType));
+}
+
+static bool IsUnsignedInteger(CXType type) {
+    switch (clang_getCanonicalType(type).kind) {
+    case CXType_Bool:
+    case CXType_Char_U:
+    case CXType_UChar:
+    case CXType_Char16:
+    case CXType_Char32:
+    case CXType_UShort:
+    case CXType_UInt:
+    case CXType_ULong:
+    case CXType_ULongLong:
+    case CXType_UInt128:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static enum CXChildVisitResult VisitEnumerator(CXCursor cursor, CXCursor, CXClientData data) {
+    TypeInfo* type = (TypeInfo*)data;
+    if (clang_getCursorKind(cursor) == CXCursor_EnumConstantDecl) {
+        EnumeratorInfo enumerator;
+        enumerator.name = ToString(clang_getCursorSpelling(cursor));
+        // Values past INT64_MAX of a 64-bit unsigned enum don't fit the signed
+        // query
+        if (type->underlyingUnsigned)
+            enumerator.value = (i64)clang_getEnumConstantDeclUnsignedValue(cursor);
+        else
+            enumerator.value = clang_getEnumConstantDeclValue(cursor);
+        ExtractDoc(cursor, &enumerator.doc);
+        type->enumerators.push_back(std::move(enumerator));
+    }
+    return CXChildVisit_Continue;
+}
+
+static void ExtractEnum(RecordState* state, CXCursor cursor, std::vector<std::string> annotations) {
+    CXType type = clang_getCursorType(cursor);
+    TypeInfo info = {};
+    info.name = ToString(clang_getTypeSpelling(type));
+    long long size = clang_Type_getSizeOf(type);
+    long long align = clang_Type_getAlignOf(type);
+    if (size < 0 || align < 0) {
+        ReportNoLayout(cursor, "type", info.name, size < 0 ? size : align);
+        return;
+    }
+    info.kind = TypeKind::Enum;
+    info.size = (u64)size;
+    info.align = (u64)align;
+    info.annotations = std::move(annotations);
+    CXType underlying = clang_getEnumDeclIntegerType(cursor);
+    info.underlyingType = ToString(clang_getTypeSpelling(underlying));
+    info.underlyingUnsigned = IsUnsignedInteger(underlying);
+    SetDeclSource(&info, cursor);
+    clang_visitChildren(cursor, VisitEnumerator, &info);
+    state->db->types.push_back(std::move(info));
+}
+
+// Only declarations tagged with the "reflect" annotation are extracted.
+// Records, enums, functions and variables without attributes are rejected
+// by clang_Cursor_hasAttrs alone and their subtree is never walked;
+// namespaces are the only thing descended into.
+static enum CXChildVisitResult VisitDecl(CXCursor cursor, CXCursor, CXClientData data) {
+    RecordState* state = (RecordState*)data;
+    switch (clang_getCursorKind(cursor)) {
+    case CXCursor_Namespace:
+    case CXCursor_LinkageSpec:
+        return CXChildVisit_Recurse;
+    case CXCursor_StructDecl:
+    case CXCursor_ClassDecl:
+    case CXCursor_UnionDecl:
+    case CXCursor_EnumDecl: {
+        if (!clang_isCursorDefinition(cursor) || !clang_Cursor_hasAttrs(cursor))
+            break;
+        std::vector<std::string> annotations = GetAnnotations(cursor);
+        if (!HasAnnotation(annotations, "reflect"))
+            break;
+        if (clang_getCursorKind(cursor) == CXCursor_EnumDecl)
+            ExtractEnum(state, cursor, std::move(annotations));
+        else
+            ExtractRecord(state, cursor, std::move(annotations));
+    } break;
+    case CXCursor_FunctionDecl: {
+        // Declarations are enough, the definition may be in another TU
+        if (!clang_Cursor_hasAttrs(cursor))
+            break;
+        std::vector<std::string> annotations = GetAnnotations(cursor);
+        if (!HasAnnotation(annotations, "reflect"))
+            break;
+        FunctionInfo function;
+        if (ExtractFunction(state->extract->types, cursor, std::move(annotations), false, &function))
+            state->db->functions.push_back(std::move(function));
+    } break;
+    case CXCursor_VarDecl: {
+        // Only reached for variables at namespace scope
+        if (!clang_Cursor_hasAttrs(cursor))
+            break;
+        std::vector<std::string> annotations = GetAnnotations(cursor);
+        if (!HasAnnotation(annotations, "reflect"))
+            break;
+        ConstantInfo constant;
+        if (ExtractConstant(state->extract->types, cursor, annotations, false, &constant)) {
+            state->db->constants.push_back(std::move(constant));
+            break;
+        }
+        VariableInfo variable;
+        ExtractVariable(state->extract->types, cursor, std::move(annotations), false, &variable);
+        state->db->variables.push_back(std::move(variable));
+    } break;
+    default:
+        break;
+    }
+    return CXChildVisit_Continue;
+}
+
+// Top level of the TU: routes every declaration to the database of the file
+// it was written in and skips the ones from other files.
+enum CXChildVisitResult visitor(CXCursor cursor, CXCursor parent, CXClientData data) {
+    ExtractState* state = (ExtractState*)data;
+    CXSourceLocation location = clang_getCursorLocation( cursor );
+    Database* db = FindTargetDatabase(state, location);
+    if(!db)
+        return CXChildVisit_Continue;
+    RecordState recordState = { state, db, 0 };
+    if (VisitDecl(cursor, parent, &recordState) == CXChildVisit_Recurse)
+        clang_visitChildren(cursor, visitor, state);
+    return CXChildVisit_Continue;
+}
+
+void ExtractTranslationUnit(CXTranslationUnit tu, TypeCache* types, const ExtractTarget* targets, size_t targetCount) {
+    ExtractState state = {};
+    types->Clear();
+    state.types = types;
+    state.targets = targets;
+    for (size_t i = 0; i < targetCount; i++)
+        state.files.push_back(clang_getFile(tu, targets[i].path.c_str()));
+    clang_visitChildren(clang_getTranslationUnitCursor(tu), visitor, &state);
+}
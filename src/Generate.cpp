@@ -0,0 +1,883 @@
+// C++ generated from the database. The source from --generate is compiled
+// into the program that uses the reflected types, the header from
+// --generate-header has the class definitions its other sources need to see.
+// Both include the reflected headers by absolute path.
+
+#include <map>
+
+static bool IsNameable(const std::string& name) {
+    return name.find("(anonymous") == std::string::npos && name.find("(unnamed") == std::string::npos;
+}
+
+static void AppendFormat(std::string* out, const char* format, ...) {
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0)
+        return;
+    if ((size_t)length < sizeof(buffer)) {
+        out->append(buffer, (size_t)length);
+        return;
+    }
+    std::string large((size_t)length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&large[0], large.size(), format, args);
+    va_end(args);
+    out->append(large.data(), (size_t)length);
+}
+
+// One thunk: unpacks the arguments, makes the call and stores the result.
+// owner is null for free functions.
+static void GenerateThunk(std::string* out, u32 index, const TypeInfo* owner, const FunctionInfo& function) {
+    bool usesObject = owner && !(function.flags & FunctionStatic);
+    bool returns = function.returnType != "void";
+    AppendFormat(out, "static void Invoke%u(void*%s, void* const*%s, void*%s) {\n    ", index, usesObject ? " object" : "",
+                 function.params.empty() ? "" : " args", returns ? " result" : "");
+    std::string call;
+    if (!owner)
+        call = "::" + function.name;
+    else if (function.flags & FunctionStatic)
+        call = owner->name + "::" + function.name;
+    else if (function.flags & FunctionRValue)
+        call = std::string("static_cast<") + ((function.flags & FunctionConst) ? "const " : "") + owner->name + "&&>(*static_cast<" + owner->name +
+               "*>(object))." + function.name;
+    else
+        call = std::string("static_cast<") + ((function.flags & FunctionConst) ? "const " : "") + owner->name + "*>(object)->" + function.name;
+    call += "(";
+    for (size_t i = 0; i < function.params.size(); i++) {
+        if (i)
+            call += ", ";
+        AppendFormat(&call, "prx::arg<%s>(args, %zu)", function.params[i].type.c_str(), i);
+    }
+    call += ")";
+    if (returns)
+        AppendFormat(out, "prx::store_result<%s>(result, %s);\n}\n\n", function.returnType.c_str(), call.c_str());
+    else
+        AppendFormat(out, "%s;\n}\n\n", call.c_str());
+}
+
+static std::string StringLiteral(const std::string& text) {
+    std::string literal = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += c;
+        } else if ((u8)c < 0x20 || c == 0x7f) {
+            // Octal, unlike hex, can't swallow the digits that follow
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\%03o", (u8)c);
+            literal += escape;
+        } else {
+            literal += c;
+        }
+    }
+    return literal + "\"";
+}
+
+static void GenerateConstantEntry(std::string* out, const std::string& name, const ConstantInfo& constant) {
+    static const char* kinds[] = { "int_value", "uint_value", "float_value", "string_value" };
+    std::string intValue = "0";
+    std::string uintValue = "0";
+    std::string floatValue = "0";
+    std::string stringValue = "0";
+    switch (constant.kind) {
+    case ConstantKind::Int:
+        // The most negative value has no literal of its own
+        if (constant.intValue == INT64_MIN)
+            intValue = "(-9223372036854775807LL - 1)";
+        else
+            intValue = std::to_string(constant.intValue) + "LL";
+        break;
+    case ConstantKind::UInt:
+        uintValue = std::to_string((u64)constant.intValue) + "ULL";
+        break;
+    case ConstantKind::Float: {
+        char buffer[64];
+        if (isnan(constant.floatValue))
+            floatValue = "std::numeric_limits<double>::quiet_NaN()";
+        else if (isinf(constant.floatValue))
+            floatValue = constant.floatValue > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+        else
+            floatValue = (snprintf(buffer, sizeof(buffer), "%.17g", constant.floatValue), buffer);
+    } break;
+    case ConstantKind::String:
+        stringValue = StringLiteral(constant.stringValue);
+        break;
+    }
+    AppendFormat(out, "    { \"%s\", \"%s\", constant_kind::%s, %s, %s, %s, %s },\n", name.c_str(), constant.type.c_str(), kinds[(u32)constant.kind],
+                 intValue.c_str(), uintValue.c_str(), floatValue.c_str(), stringValue.c_str());
+}
+
+static std::string SymbolLiteral(const std::string& symbol) {
+    return symbol.empty() ? "0" : "\"" + symbol + "\"";
+}
+
+static void GenerateFunctionEntry(std::string* out, u32 index, const FunctionInfo& function) {
+    AppendFormat(out, "    { \"%s\", \"%s\", PRX_THUNK(Invoke%u), %zu, %s },\n", function.name.c_str(), FunctionSignature(function).c_str(), index,
+                 function.params.size(), SymbolLiteral(function.mangledName).c_str());
+}
+
+static void GenerateVariableEntry(std::string* out, const std::string& name, const VariableInfo& variable) {
+    AppendFormat(out, "    { \"%s\", %s },\n", name.c_str(), SymbolLiteral(variable.mangledName).c_str());
+}
+
+// One key a generated reader dispatches on, and the lines it runs for it
+struct KeyCase {
+    std::string key;
+    std::vector<std::string> lines;
+};
+
+// A perfect hash for keys of one length: the position of a character that
+// differs between all of them, or failing that two positions whose pair of
+// characters does. The keys are told apart without hashing the whole key.
+static bool FindKeyHash(const std::vector<const KeyCase*>& cases, size_t length, std::string* hash, std::vector<u32>* values) {
+    for (size_t i = 0; i < length; i++) {
+        std::unordered_set<u32> seen;
+        values->clear();
+        for (const KeyCase* it : cases) {
+            u32 value = (u8)it->key[i];
+            if (!seen.insert(value).second)
+                break;
+            values->push_back(value);
+        }
+        if (values->size() == cases.size()) {
+            *hash = "(unsigned char)key[" + std::to_string(i) + "]";
+            return true;
+        }
+    }
+    for (size_t i = 0; i < length; i++) {
+        for (size_t j = i + 1; j < length; j++) {
+            std::unordered_set<u32> seen;
+            values->clear();
+            for (const KeyCase* it : cases) {
+                u32 value = (u32)(u8)it->key[i] << 8 | (u8)it->key[j];
+                if (!seen.insert(value).second)
+                    break;
+                values->push_back(value);
+            }
+            if (values->size() == cases.size()) {
+                *hash = "((unsigned)(unsigned char)key[" + std::to_string(i) + "] << 8 | (unsigned char)key[" + std::to_string(j) + "])";
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// The hash only picks a candidate, the compare confirms it
+static void GenerateKeyMatch(std::string* out, const KeyCase& match, const std::string& indent) {
+    AppendFormat(out, "%sif (memcmp(key, %s, %zu) == 0) {\n", indent.c_str(), StringLiteral(match.key).c_str(), match.key.size());
+    for (const std::string& line : match.lines)
+        AppendFormat(out, "%s    %s\n", indent.c_str(), line.c_str());
+    AppendFormat(out, "%s}\n", indent.c_str());
+}
+
+// Dispatches on key and size, the key's length first. Unmatched keys fall
+// out of the switch.
+static void GenerateKeySwitch(std::string* out, const std::vector<KeyCase>& cases, const std::string& indent) {
+    std::map<size_t, std::vector<const KeyCase*>> byLength;
+    for (const KeyCase& it : cases)
+        byLength[it.key.size()].push_back(&it);
+    AppendFormat(out, "%sswitch (size) {\n", indent.c_str());
+    for (const auto& group : byLength) {
+        AppendFormat(out, "%scase %zu:\n", indent.c_str(), group.first);
+        std::string inner = indent + "    ";
+        std::string hash;
+        std::vector<u32> values;
+        if (group.second.size() > 1 && FindKeyHash(group.second, group.first, &hash, &values)) {
+            AppendFormat(out, "%sswitch (%s) {\n", inner.c_str(), hash.c_str());
+            for (size_t i = 0; i < group.second.size(); i++) {
+                AppendFormat(out, "%scase %u:\n", inner.c_str(), values[i]);
+                GenerateKeyMatch(out, *group.second[i], inner + "    ");
+                AppendFormat(out, "%s    break;\n", inner.c_str());
+            }
+            AppendFormat(out, "%s}\n", inner.c_str());
+        } else {
+            for (const KeyCase* it : group.second)
+                GenerateKeyMatch(out, *it, inner);
+        }
+        AppendFormat(out, "%s    break;\n", indent.c_str());
+    }
+    AppendFormat(out, "%s}\n", indent.c_str());
+}
+
+// Public fields of the type and of its reflected bases, bases first, as the
+// expression that names each on value
+static void CollectJsonFields(const Database& db, const TypeInfo& type, const std::string& qualifier, std::vector<std::pair<std::string, std::string>>* fields) {
+    for (const std::string& base : type.bases) {
+        auto it = db.typeIndex.find(base);
+        if (it != db.typeIndex.end())
+            CollectJsonFields(db, db.types[it->second], base + "::", fields);
+    }
+    for (const FieldInfo& field : type.fields) {
+        // Anonymous structs and unions have no name to key them by
+        if (!(field.flags & FieldPublic) || field.name.empty())
+            continue;
+        // A field hides base fields of the same name
+        for (size_t i = 0; i < fields->size(); i++) {
+            if ((*fields)[i].first == field.name) {
+                fields->erase(fields->begin() + (ptrdiff_t)i);
+                break;
+            }
+        }
+        fields->push_back({ field.name, "value." + qualifier + field.name });
+    }
+}
+
+static void GenerateJsonRecord(std::string* out, const Database& db, const TypeInfo& type) {
+    std::vector<std::pair<std::string, std::string>> fields;
+    CollectJsonFields(db, type, "", &fields);
+
+    // Keys go out as literals with the punctuation around them
+    AppendFormat(out, "template <> void json<%s>::write(json_writer& out, const %s& value) {\n", type.name.c_str(), type.name.c_str());
+    if (fields.empty())
+        out->append("    out.raw(\"{}\", 2);\n");
+    for (size_t i = 0; i < fields.size(); i++) {
+        std::string key = (i ? ",\"" : "{\"") + fields[i].first + "\":";
+        AppendFormat(out, "    out.raw(%s, %zu);\n", StringLiteral(key).c_str(), key.size());
+        AppendFormat(out, "    prx::json_write(out, %s);\n", fields[i].second.c_str());
+    }
+    if (!fields.empty())
+        out->append("    out.raw('}');\n");
+    out->append("}\n\n");
+
+    std::vector<KeyCase> cases;
+    for (const auto& field : fields)
+        cases.push_back({ field.first, { "if (!prx::json_read(in, " + field.second + "))", "    return false;", "continue;" } });
+    AppendFormat(out, "template <> bool json<%s>::read(json_reader& in, %s& value) {\n", type.name.c_str(), type.name.c_str());
+    out->append("    if (!in.begin_object())\n        return false;\n    const char* key;\n    size_t size;\n");
+    out->append("    for (bool first = true; in.next_key(&key, &size, first); first = false) {\n");
+    if (!cases.empty())
+        GenerateKeySwitch(out, cases, "        ");
+    out->append("        if (!in.skip_value())\n            return false;\n    }\n    return in.ok;\n}\n\n");
+}
+
+// Enumerators are written by name, values without one as numbers. Either is
+// read back.
+static void GenerateJsonEnum(std::string* out, const TypeInfo& type) {
+    std::vector<const EnumeratorInfo*> named;
+    std::unordered_set<i64> values;
+    for (const EnumeratorInfo& enumerator : type.enumerators) {
+        // Aliases of one value would be duplicate cases, the first name wins
+        if (values.insert(enumerator.value).second)
+            named.push_back(&enumerator);
+    }
+    const char* name = type.name.c_str();
+    AppendFormat(out, "template <> void json<%s>::write(json_writer& out, const %s& value) {\n    switch (value) {\n", name, name);
+    for (const EnumeratorInfo* enumerator : named) {
+        std::string literal = "\"" + enumerator->name + "\"";
+        AppendFormat(out, "    case %s::%s:\n        out.raw(%s, %zu);\n        return;\n", name, enumerator->name.c_str(), StringLiteral(literal).c_str(),
+                     literal.size());
+    }
+    AppendFormat(out, "    default:\n        break;\n    }\n    prx::json_write(out, static_cast<std::underlying_type<%s>::type>(value));\n}\n\n", name);
+
+    std::vector<KeyCase> cases;
+    for (const EnumeratorInfo& enumerator : type.enumerators)
+        cases.push_back({ enumerator.name, { "value = " + type.name + "::" + enumerator.name + ";", "return true;" } });
+    AppendFormat(out, "template <> bool json<%s>::read(json_reader& in, %s& value) {\n", name, name);
+    AppendFormat(out, "    if (!in.peek('\"')) {\n        std::underlying_type<%s>::type number;\n", name);
+    AppendFormat(out, "        if (!prx::json_read(in, number))\n            return false;\n        value = static_cast<%s>(number);\n        return true;\n    }\n", name);
+    out->append("    const char* key;\n    size_t size;\n    if (!in.string_view(&key, &size))\n        return false;\n");
+    if (!cases.empty())
+        GenerateKeySwitch(out, cases, "    ");
+    out->append("    return in.fail();\n}\n\n");
+}
+
+// The element type of an array, or the type itself
+static std::string ElementTypeName(std::string type) {
+    while (!type.empty() && type.back() == ']') {
+        size_t open = type.rfind('[');
+        if (open == std::string::npos)
+            break;
+        type.erase(open);
+        while (!type.empty() && type.back() == ' ')
+            type.pop_back();
+    }
+    return type;
+}
+
+static bool IsBitwiseRecord(const Database& db, const TypeInfo& type, std::unordered_map<std::string, bool>* known);
+
+static bool IsBitwiseField(const Database& db, const FieldInfo& field, std::unordered_map<std::string, bool>* known) {
+    if (field.flags & FieldBitwise)
+        return true;
+    auto it = db.typeIndex.find(ElementTypeName(field.canonicalType));
+    return it != db.typeIndex.end() && IsBitwiseRecord(db, db.types[it->second], known);
+}
+
+// A record whose bytes are its value: no bases, bitwise fields, and no byte
+// that isn't one of theirs. Padding, a vtable pointer and fields reflection
+// leaves out all show up as bytes no field covers.
+static bool IsBitwiseRecord(const Database& db, const TypeInfo& type, std::unordered_map<std::string, bool>* known) {
+    auto it = known->find(type.name);
+    if (it != known->end())
+        return it->second;
+    bool bitwise = type.kind == TypeKind::Record && type.bases.empty();
+    std::vector<const FieldInfo*> fields;
+    for (const FieldInfo& field : type.fields)
+        fields.push_back(&field);
+    std::stable_sort(fields.begin(), fields.end(), [](const FieldInfo* a, const FieldInfo* b) { return a->offset < b->offset; });
+    u64 covered = 0;
+    for (const FieldInfo* field : fields) {
+        if (!bitwise)
+            break;
+        bitwise = field->offset == covered && IsBitwiseField(db, *field, known);
+        covered += field->size;
+    }
+    bitwise = bitwise && covered == type.size;
+    (*known)[type.name] = bitwise;
+    return bitwise;
+}
+
+// One step of a field by field compare: a run of adjacent bitwise fields, a
+// field compared through its type or a base
+struct CompareStep {
+    u64 offset;
+    u64 size;
+    std::string field;
+    std::string base;
+};
+
+static void GenerateHashRecord(std::string* out, const Database& db, const TypeInfo& type, std::unordered_map<std::string, bool>* known) {
+    const char* name = type.name.c_str();
+    // Keys that differ only in a field reflection doesn't see would compare
+    // equal
+    if (type.hiddenFields) {
+        fprintf(stderr, "scan: %s: no hash for PRX_HASH, it has bit-fields or PRX_NOREFLECT fields\n", name);
+        return;
+    }
+    if (IsBitwiseRecord(db, type, known)) {
+        AppendFormat(out, "template <> size_t hash<%s>::operator()(const %s& value) const {\n    return prx::hash_bytes(&value, sizeof(value));\n}\n\n", name, name);
+        AppendFormat(out, "template <> bool equal_to<%s>::operator()(const %s& a, const %s& b) const {\n    return memcmp(&a, &b, sizeof(a)) == 0;\n}\n\n", name, name,
+                     name);
+        return;
+    }
+
+    std::vector<CompareStep> steps;
+    for (const std::string& base : type.bases)
+        steps.push_back({ 0, 0, std::string(), base });
+    std::vector<const FieldInfo*> fields;
+    for (const FieldInfo& field : type.fields)
+        fields.push_back(&field);
+    std::stable_sort(fields.begin(), fields.end(), [](const FieldInfo* a, const FieldInfo* b) { return a->offset < b->offset; });
+    bool runOpen = false;
+    for (const FieldInfo* field : fields) {
+        // clang had no layout for the field, a type it failed to parse
+        if (field->offset > type.size || field->size > type.size - field->offset) {
+            fprintf(stderr, "scan: %s: no hash for PRX_HASH, the layout of field %s is unknown\n", name, field->name.c_str());
+            return;
+        }
+        if (IsBitwiseField(db, *field, known)) {
+            CompareStep* last = runOpen ? &steps.back() : 0;
+            if (last && last->offset + last->size == field->offset)
+                last->size += field->size;
+            else
+                steps.push_back({ field->offset, field->size, std::string(), std::string() });
+            runOpen = true;
+            continue;
+        }
+        runOpen = false;
+        if (!(field->flags & FieldPublic) || field->name.empty()) {
+            fprintf(stderr, "scan: %s: no hash for PRX_HASH, field %s is neither public nor comparable by bytes\n", name,
+                    field->name.empty() ? "(anonymous)" : field->name.c_str());
+            return;
+        }
+        steps.push_back({ field->offset, field->size, field->name, std::string() });
+    }
+
+    AppendFormat(out, "template <> size_t hash<%s>::operator()(const %s& value) const {\n    size_t result = prx::hash_bytes(\"\", 0);\n", name, name);
+    for (const CompareStep& step : steps) {
+        if (!step.base.empty())
+            AppendFormat(out, "    result = prx::hash_combine(result, prx::hash_value(static_cast<const %s&>(value)));\n", step.base.c_str());
+        else if (!step.field.empty())
+            AppendFormat(out, "    result = prx::hash_combine(result, prx::hash_value(value.%s));\n", step.field.c_str());
+        else
+            AppendFormat(out, "    result = prx::hash_combine(result, prx::hash_bytes((const char*)&value + %llu, %llu));\n", (unsigned long long)step.offset,
+                         (unsigned long long)step.size);
+    }
+    out->append("    return result;\n}\n\n");
+
+    AppendFormat(out, "template <> bool equal_to<%s>::operator()(const %s& a, const %s& b) const {\n", name, name, name);
+    for (const CompareStep& step : steps) {
+        if (!step.base.empty())
+            AppendFormat(out, "    if (!prx::equal_value(static_cast<const %s&>(a), static_cast<const %s&>(b)))\n", step.base.c_str(), step.base.c_str());
+        else if (!step.field.empty())
+            AppendFormat(out, "    if (!prx::equal_value(a.%s, b.%s))\n", step.field.c_str(), step.field.c_str());
+        else
+            AppendFormat(out, "    if (memcmp((const char*)&a + %llu, (const char*)&b + %llu, %llu) != 0)\n", (unsigned long long)step.offset,
+                         (unsigned long long)step.offset, (unsigned long long)step.size);
+        out->append("        return false;\n");
+    }
+    out->append("    return true;\n}\n\n");
+}
+
+// The same mix as prx::field_slot_of
+static u32 FieldSlotOf(u64 nameHash, u32 seed) {
+    return (u32)(((nameHash ^ seed) * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+// A perfect hash over the names of the type's fields for
+// registry::find_field, by hash and displace: buckets are placed fullest
+// first, each with the first seed that sends all its names to free slots.
+// slots gets a power of two of (seed, field) pairs. Fails when a seed can't
+// be found, which takes two names of the same hash.
+static bool FindFieldSlots(const TypeInfo& type, std::vector<std::pair<u32, u32>>* slots) {
+    u32 count = 1;
+    while (count < type.fields.size())
+        count *= 2;
+    u32 mask = count - 1;
+    std::vector<u64> hashes;
+    std::vector<std::vector<u32>> buckets(count);
+    for (u32 i = 0; i < (u32)type.fields.size(); i++) {
+        hashes.push_back(HashBytes(type.fields[i].name.data(), type.fields[i].name.size()));
+        // Anonymous fields can't be looked up by name
+        if (!type.fields[i].name.empty())
+            buckets[(u32)hashes[i] & mask].push_back(i);
+    }
+    std::vector<u32> order(count);
+    for (u32 i = 0; i < count; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) { return buckets[a].size() > buckets[b].size(); });
+
+    slots->assign(count, std::make_pair(0u, 0u));
+    std::vector<bool> used(count);
+    std::vector<u32> taken;
+    for (u32 bucket : order) {
+        if (buckets[bucket].empty())
+            break;
+        u32 seed = 0;
+        for (;; seed++) {
+            if (seed == 1u << 20)
+                return false;
+            taken.clear();
+            for (u32 field : buckets[bucket]) {
+                u32 slot = FieldSlotOf(hashes[field], seed) & mask;
+                if (used[slot] || std::find(taken.begin(), taken.end(), slot) != taken.end())
+                    break;
+                taken.push_back(slot);
+            }
+            if (taken.size() == buckets[bucket].size())
+                break;
+        }
+        (*slots)[bucket].first = seed;
+        for (size_t i = 0; i < taken.size(); i++) {
+            used[taken[i]] = true;
+            (*slots)[taken[i]].second = buckets[bucket][i];
+        }
+    }
+    return true;
+}
+
+// The registry tables: a record per type, indexed by its place in the
+// database, with its fields and bases in flat arrays and the strings apart.
+// Nameable types are measured by the compiler, the rest by the scan.
+static void GenerateRegistryTables(std::string* out, const Database& db) {
+    std::string types;
+    std::string names;
+    std::string fields;
+    std::string fieldStrings;
+    std::string fieldSlots;
+    std::string bases;
+    u32 fieldCount = 0;
+    u32 fieldSlotCount = 0;
+    u32 baseCount = 0;
+    for (const TypeInfo& type : db.types) {
+        std::string size = std::to_string(type.size);
+        std::string align = std::to_string(type.align);
+        std::string flags = type.kind == TypeKind::Enum ? "type_enum" : "0";
+        std::string ops = "0";
+        if (IsNameable(type.name)) {
+            size = "sizeof(::" + type.name + ")";
+            align = "alignof(::" + type.name + ")";
+            flags = "type_flags_of<::" + type.name + ">()";
+            ops = "&type_ops_of<::" + type.name + ">::value";
+        }
+        u32 baseFirst = baseCount;
+        for (const std::string& base : type.bases) {
+            auto it = db.typeIndex.find(base);
+            if (it == db.typeIndex.end())
+                continue;
+            AppendFormat(&bases, "    %u,\n", it->second);
+            baseCount++;
+        }
+        std::vector<std::pair<u32, u32>> slots;
+        if (type.fields.empty() || !FindFieldSlots(type, &slots))
+            slots.clear();
+        for (const auto& slot : slots)
+            AppendFormat(&fieldSlots, "    { %u, %u },\n", slot.first, slot.second);
+        AppendFormat(&types, "    { %s, %s, %s, 0x%llxull, %u, %zu, %u, %zu, %u, %u, %s },\n", size.c_str(), align.c_str(), flags.c_str(),
+                     (unsigned long long)HashBytes(type.name.data(), type.name.size()), fieldCount, type.fields.size(), fieldSlotCount, slots.size(),
+                     baseFirst, baseCount - baseFirst, ops.c_str());
+        fieldSlotCount += (u32)slots.size();
+        AppendFormat(&names, "    %s,\n", StringLiteral(type.name).c_str());
+        for (const FieldInfo& field : type.fields) {
+            auto it = db.typeIndex.find(field.canonicalType);
+            std::string fieldType = it != db.typeIndex.end() ? std::to_string(it->second) : "invalid_type_id";
+            std::string fieldFlags = "0";
+            if (field.flags & FieldPublic)
+                fieldFlags = "field_public";
+            if (field.flags & FieldBitwise)
+                fieldFlags = fieldFlags == "0" ? "field_bitwise" : fieldFlags + " | field_bitwise";
+            AppendFormat(&fields, "    { 0x%llxull, %llu, %llu, %s, %s },\n", (unsigned long long)HashBytes(field.name.data(), field.name.size()),
+                         (unsigned long long)field.offset, (unsigned long long)field.size, fieldType.c_str(), fieldFlags.c_str());
+            AppendFormat(&fieldStrings, "    { %s, %s },\n", StringLiteral(field.name).c_str(), StringLiteral(field.type).c_str());
+            fieldCount++;
+        }
+    }
+    // An empty array isn't valid C++, the tables always have a terminator
+    types += "    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },\n";
+    names += "    0,\n";
+    fields += "    { 0, 0, 0, invalid_type_id, 0 },\n";
+    fieldStrings += "    { 0, 0 },\n";
+    fieldSlots += "    { 0, 0 },\n";
+    bases += "    invalid_type_id,\n";
+    AppendFormat(out, "const type_record types[] = {\n%s};\n\nconst char* const type_names[] = {\n%s};\n\n", types.c_str(), names.c_str());
+    AppendFormat(out, "const size_t type_count = %zu;\n\n", db.types.size());
+    AppendFormat(out, "const field_record fields[] = {\n%s};\n\nconst field_names field_strings[] = {\n%s};\n\n", fields.c_str(), fieldStrings.c_str());
+    AppendFormat(out, "const size_t field_count = %u;\n\n", fieldCount);
+    AppendFormat(out, "const field_slot field_slots[] = {\n%s};\n\n", fieldSlots.c_str());
+    AppendFormat(out, "const type_id bases[] = {\n%s};\n\nconst size_t base_count = %u;\n\n", bases.c_str(), baseCount);
+}
+
+std::string GenerateSource(const Database& db) {
+    std::vector<std::string> includes;
+    for (const TypeInfo& type : db.types)
+        includes.push_back(AbsolutePath(type.file));
+    for (const FunctionInfo& function : db.functions)
+        includes.push_back(AbsolutePath(function.file));
+    for (const VariableInfo& variable : db.variables)
+        includes.push_back(AbsolutePath(variable.file));
+    std::sort(includes.begin(), includes.end());
+    includes.erase(std::unique(includes.begin(), includes.end()), includes.end());
+
+    // Types tagged PRX_JSON
+    std::vector<const TypeInfo*> jsonTypes;
+    // Records tagged PRX_HASH
+    std::vector<const TypeInfo*> hashTypes;
+    for (const TypeInfo& type : db.types) {
+        if (!IsNameable(type.name))
+            continue;
+        if (HasAnnotation(type.annotations, "json"))
+            jsonTypes.push_back(&type);
+        if (HasAnnotation(type.annotations, "hash") && type.kind == TypeKind::Record)
+            hashTypes.push_back(&type);
+    }
+
+    std::string out = "// Generated by scan, do not edit.\n\n#include <prx/Constants.h>\n#include <prx/Invoke.h>\n#include <prx/Registry.h>\n";
+    if (!hashTypes.empty())
+        out += "#include <prx/Hash.h>\n";
+    if (!jsonTypes.empty())
+        out += "#include <prx/Json.h>\n";
+    out += "\n";
+    for (const std::string& include : includes)
+        AppendFormat(&out, "#include \"%s\"\n", include.c_str());
+    if (!jsonTypes.empty() || !hashTypes.empty()) {
+        out += "\nnamespace prx {\n\n";
+        for (const TypeInfo* type : jsonTypes) {
+            if (type->kind == TypeKind::Enum)
+                GenerateJsonEnum(&out, *type);
+            else
+                GenerateJsonRecord(&out, db, *type);
+        }
+        std::unordered_map<std::string, bool> bitwise;
+        for (const TypeInfo* type : hashTypes)
+            GenerateHashRecord(&out, db, *type, &bitwise);
+        out += "} // namespace prx\n";
+    }
+    // Thunks reference the functions they call. A plugin host that only binds
+    // symbols at run time (prx/Bind.h) builds this file with PRX_NO_THUNKS
+    // and doesn't need them at link time.
+    out += "\n#if defined(PRX_NO_THUNKS)\n#define PRX_THUNK(thunk) 0\n#else\n#define PRX_THUNK(thunk) thunk\n\n";
+
+    std::string entries;
+    u32 count = 0;
+    std::string variableEntries;
+    u32 variableCount = 0;
+    std::string constantEntries;
+    u32 constantCount = 0;
+    for (const TypeInfo& type : db.types) {
+        if (!IsNameable(type.name))
+            continue;
+        for (const FunctionInfo& method : type.methods) {
+            GenerateThunk(&out, count, &type, method);
+            FunctionInfo qualified = method;
+            qualified.name = type.name + "::" + method.name;
+            GenerateFunctionEntry(&entries, count, qualified);
+            count++;
+        }
+        for (const VariableInfo& field : type.staticFields) {
+            GenerateVariableEntry(&variableEntries, type.name + "::" + field.name, field);
+            variableCount++;
+        }
+        for (const ConstantInfo& constant : type.constants) {
+            GenerateConstantEntry(&constantEntries, type.name + "::" + constant.name, constant);
+            constantCount++;
+        }
+    }
+    for (const FunctionInfo& function : db.functions) {
+        GenerateThunk(&out, count, 0, function);
+        GenerateFunctionEntry(&entries, count, function);
+        count++;
+    }
+    for (const VariableInfo& variable : db.variables) {
+        GenerateVariableEntry(&variableEntries, variable.name, variable);
+        variableCount++;
+    }
+    for (const ConstantInfo& constant : db.constants) {
+        GenerateConstantEntry(&constantEntries, constant.name, constant);
+        constantCount++;
+    }
+    out += "#endif\n\n";
+    // An empty array isn't valid C++, the tables always have a terminator
+    entries += "    { 0, 0, 0, 0, 0 },\n";
+    variableEntries += "    { 0, 0 },\n";
+    constantEntries += "    { 0, 0, constant_kind::int_value, 0, 0, 0, 0 },\n";
+
+    AppendFormat(&out, "namespace prx {\nnamespace generated {\n\nconst function_entry functions[] = {\n%s};\n\n", entries.c_str());
+    AppendFormat(&out, "const size_t function_count = %u;\n\n", count);
+    AppendFormat(&out, "const variable_entry variables[] = {\n%s};\n\n", variableEntries.c_str());
+    AppendFormat(&out, "const size_t variable_count = %u;\n\n", variableCount);
+    AppendFormat(&out, "const constant_entry constants[] = {\n%s};\n\n", constantEntries.c_str());
+    AppendFormat(&out, "const size_t constant_count = %u;\n\n", constantCount);
+    GenerateRegistryTables(&out, db);
+    out += "} // namespace generated\n} // namespace prx\n";
+    return out;
+}
+
+// Names soa_vector and soa_storage use themselves, a column can't be named
+// after them
+static const char* SoaReservedNames[] = {
+    "size", "capacity", "empty", "column", "reserve", "shrink_to_fit", "clear", "push_back", "pop_back", "resize", "erase", "erase_at",
+    "swap_erase_at", "get", "set", "swap", "begin", "end", "front", "back", "reference", "const_reference", "iterator", "const_iterator",
+    "value_type", "size_type", "column_count", "column_type", "column_alignment",
+};
+
+// The generated classes in the header take the struct apart and put it back
+// together field by field, which needs every field public and no bases
+static bool CanRebuildFromFields(const TypeInfo& type, const char* what) {
+    if (!type.bases.empty()) {
+        fprintf(stderr, "scan: %s: no %s, the struct has bases\n", type.name.c_str(), what);
+        return false;
+    }
+    for (const FieldInfo& field : type.fields) {
+        if (!(field.flags & FieldPublic) || field.name.empty()) {
+            fprintf(stderr, "scan: %s: no %s, field %s isn't public\n", type.name.c_str(), what, field.name.empty() ? "(anonymous)" : field.name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool IsReservedName(const char* const* names, size_t count, const std::string& name) {
+    for (size_t i = 0; i < count; i++)
+        if (name == names[i])
+            return true;
+    return false;
+}
+
+// A soa_vector specialization: the storage for the fields as columns, plus
+// what needs the field names: the column accessors and the element proxies
+static void GenerateSoaVector(std::string* out, const TypeInfo& type) {
+    const char* name = type.name.c_str();
+    if (!CanRebuildFromFields(type, "soa_vector for PRX_SOA"))
+        return;
+
+    std::string members;
+    for (const FieldInfo& field : type.fields)
+        members += ", &" + type.name + "::" + field.name;
+    AppendFormat(out, "template <> class soa_vector<%s> : public soa_storage<%s%s> {\npublic:\n", name, name, members.c_str());
+
+    // The proxies, one reference per field. A reference converts to a
+    // const_reference, which comes first for that.
+    for (int constant = 1; constant >= 0; constant--) {
+        const char* proxy = constant ? "const_reference" : "reference";
+        const char* qualifier = constant ? "const " : "";
+        AppendFormat(out, "    struct %s {\n", proxy);
+        for (const FieldInfo& field : type.fields)
+            AppendFormat(out, "        %sdecltype(%s::%s)& %s;\n", qualifier, name, field.name.c_str(), field.name.c_str());
+        AppendFormat(out, "\n        operator %s() const {\n            %s value = {};\n", name, name);
+        for (const FieldInfo& field : type.fields)
+            AppendFormat(out, "            detail::soa_assign(value.%s, %s);\n", field.name.c_str(), field.name.c_str());
+        out->append("            return value;\n        }\n");
+        if (!constant) {
+            out->append("        operator const_reference() const {\n            return { ");
+            for (size_t i = 0; i < type.fields.size(); i++)
+                AppendFormat(out, "%s%s", i ? ", " : "", type.fields[i].name.c_str());
+            out->append(" };\n        }\n");
+            AppendFormat(out, "        const reference& operator=(const %s& value) const {\n", name);
+            for (const FieldInfo& field : type.fields)
+                AppendFormat(out, "            detail::soa_assign(%s, value.%s);\n", field.name.c_str(), field.name.c_str());
+            out->append("            return *this;\n        }\n");
+        }
+        out->append("    };\n\n");
+    }
+    out->append("    typedef soa_iterator<soa_vector, reference> iterator;\n    typedef soa_iterator<const soa_vector, const_reference> const_iterator;\n\n");
+
+    for (int constant = 0; constant < 2; constant++) {
+        AppendFormat(out, "    %s operator[](size_t index)%s {\n        return { ", constant ? "const_reference" : "reference", constant ? " const" : "");
+        for (size_t i = 0; i < type.fields.size(); i++)
+            AppendFormat(out, "%scolumn<%zu>()[index]", i ? ", " : "", i);
+        out->append(" };\n    }\n");
+    }
+    out->append("    reference front() { return (*this)[0]; }\n    const_reference front() const { return (*this)[0]; }\n");
+    out->append("    reference back() { return (*this)[size() - 1]; }\n    const_reference back() const { return (*this)[size() - 1]; }\n");
+    out->append("    iterator begin() { return iterator(this, 0); }\n    iterator end() { return iterator(this, size()); }\n");
+    out->append("    const_iterator begin() const { return const_iterator(this, 0); }\n    const_iterator end() const { return const_iterator(this, size()); }\n");
+    out->append("    iterator erase(const_iterator at) {\n        erase_at(at.index);\n        return iterator(this, at.index);\n    }\n");
+    out->append("    iterator erase(const_iterator first, const_iterator last) {\n        erase_at(first.index, last.index);\n");
+    out->append("        return iterator(this, first.index);\n    }\n");
+
+    // Column views, named after the fields
+    for (size_t i = 0; i < type.fields.size(); i++) {
+        const char* field = type.fields[i].name.c_str();
+        if (IsReservedName(SoaReservedNames, sizeof(SoaReservedNames) / sizeof(SoaReservedNames[0]), field)) {
+            fprintf(stderr, "scan: %s: field %s has no column accessor in soa_vector, use column<%zu>()\n", name, field, i);
+            continue;
+        }
+        AppendFormat(out, "    column_view<decltype(%s::%s)> %s() { return { column<%zu>(), size() }; }\n", name, field, field, i);
+        AppendFormat(out, "    column_view<const decltype(%s::%s)> %s() const { return { column<%zu>(), size() }; }\n", name, field, field, i);
+    }
+    out->append("};\n\n");
+}
+
+static const char* TrackedReservedNames[] = {
+    "get", "set", "dirty", "clear_dirty", "mark_all", "write_delta", "apply_delta", "field_count",
+};
+
+// A tracked specialization: accessors and setters per field, field i marking
+// bit i of the dirty mask, and the delta writer and applier unrolled over the
+// fields
+static void GenerateTracked(std::string* out, const TypeInfo& type) {
+    const char* name = type.name.c_str();
+    if (!CanRebuildFromFields(type, "tracked for PRX_REPLICATE"))
+        return;
+    size_t count = type.fields.size();
+    size_t words = count ? (count + 63) / 64 : 1;
+    size_t maskBytes = (count + 7) / 8;
+    AppendFormat(out, "template <> class tracked<%s> {\npublic:\n    static constexpr size_t field_count = %zu;\n\n", name, count);
+    AppendFormat(out, "    tracked() : value_() {\n        mark_all();\n    }\n    tracked(const %s& value) : value_(value) {\n        mark_all();\n    }\n\n", name);
+    AppendFormat(out, "    const %s& get() const { return value_; }\n    void set(const %s& value) {\n        value_ = value;\n        mark_all();\n    }\n\n", name, name);
+
+    std::string any;
+    std::string clear;
+    std::string all;
+    for (size_t word = 0; word < words; word++) {
+        size_t bits = count - word * 64 < 64 ? count - word * 64 : 64;
+        u64 mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+        AppendFormat(&any, "%sdirty_[%zu]", word ? " | " : "", word);
+        AppendFormat(&clear, "        dirty_[%zu] = 0;\n", word);
+        AppendFormat(&all, "        dirty_[%zu] = 0x%llxull;\n", word, (unsigned long long)mask);
+    }
+    AppendFormat(out, "    bool dirty() const { return (%s) != 0; }\n", any.c_str());
+    AppendFormat(out, "    void clear_dirty() {\n%s    }\n    void mark_all() {\n%s    }\n\n", clear.c_str(), all.c_str());
+
+    for (size_t i = 0; i < count; i++) {
+        const FieldInfo& field = type.fields[i];
+        const char* fieldName = field.name.c_str();
+        if (IsReservedName(TrackedReservedNames, sizeof(TrackedReservedNames) / sizeof(TrackedReservedNames[0]), field.name)) {
+            fprintf(stderr, "scan: %s: field %s has no accessors in tracked, it clashes with a member\n", name, fieldName);
+            continue;
+        }
+        std::string fieldType = "decltype(" + type.name + "::" + field.name + ")";
+        std::string mark = "dirty_[" + std::to_string(i / 64) + "] |= 1ull << " + std::to_string(i % 64) + ";";
+        AppendFormat(out, "    const %s& %s() const { return value_.%s; }\n", fieldType.c_str(), fieldName, fieldName);
+        // Arrays can't be assigned, they are changed through mutate_
+        if (field.canonicalType.empty() || field.canonicalType.back() != ']') {
+            AppendFormat(out, "    void set_%s(const %s& value) {\n        value_.%s = value;\n        %s\n    }\n", fieldName, fieldType.c_str(), fieldName,
+                         mark.c_str());
+        }
+        AppendFormat(out, "    %s& mutate_%s() {\n        %s\n        return value_.%s;\n    }\n", fieldType.c_str(), fieldName, mark.c_str(), fieldName);
+    }
+
+    AppendFormat(out, "\n    void write_delta(delta_writer& out) const {\n        const unsigned char mask[%zu] = { ", maskBytes ? maskBytes : 1);
+    for (size_t byte = 0; byte < maskBytes; byte++)
+        AppendFormat(out, "%s(unsigned char)(dirty_[%zu] >> %zu)", byte ? ", " : "", byte / 8, (byte % 8) * 8);
+    AppendFormat(out, " };\n        out.write(mask, %zu);\n", maskBytes);
+    for (size_t i = 0; i < count; i++)
+        AppendFormat(out, "        if (dirty_[%zu] & (1ull << %zu))\n            prx::delta_write(out, value_.%s);\n", i / 64, i % 64, type.fields[i].name.c_str());
+    out->append("    }\n\n");
+
+    // Mask bits past the last field mean the other end has another layout
+    AppendFormat(out, "    bool apply_delta(delta_reader& in) {\n        unsigned char mask[%zu];\n        if (!in.read(mask, %zu))\n            return false;\n",
+                 maskBytes ? maskBytes : 1, maskBytes);
+    if (count % 8)
+        AppendFormat(out, "        if (mask[%zu] & 0x%x)\n            return in.ok = false;\n", maskBytes - 1, (0xffu << (count % 8)) & 0xffu);
+    for (size_t i = 0; i < count; i++) {
+        AppendFormat(out, "        if ((mask[%zu] & 0x%x) && !prx::delta_read(in, value_.%s))\n            return false;\n", i / 8, 1u << (i % 8),
+                     type.fields[i].name.c_str());
+    }
+    AppendFormat(out, "        return true;\n    }\n\nprivate:\n    %s value_;\n    uint64_t dirty_[%zu];\n};\n\n", name, words);
+}
+
+// A reflect specialization: the public fields as constant descriptors, and
+// the bases that have one too
+static void GenerateReflect(std::string* out, const Database& db, const TypeInfo& type) {
+    const char* name = type.name.c_str();
+    std::string bases;
+    for (const std::string& base : type.bases) {
+        auto it = db.typeIndex.find(base);
+        if (it != db.typeIndex.end() && db.types[it->second].kind == TypeKind::Record && IsNameable(base))
+            AppendFormat(&bases, "%s%s", bases.empty() ? "" : ", ", base.c_str());
+    }
+    std::string fields;
+    size_t count = 0;
+    for (const FieldInfo& field : type.fields) {
+        // There are no pointers to reference members
+        if (!(field.flags & FieldPublic) || field.name.empty() || field.canonicalType.empty() || field.canonicalType.back() == '&')
+            continue;
+        AppendFormat(&fields, "%s        field_descriptor<%s, decltype(%s::%s)>{ &%s::%s, \"%s\", %llu }", count ? ",\n" : "", name, name,
+                     field.name.c_str(), name, field.name.c_str(), field.name.c_str(), (unsigned long long)field.offset);
+        count++;
+    }
+    AppendFormat(out, "template <> struct reflect<%s> {\n    static constexpr type_id id = %u;\n    static constexpr const char* name = \"%s\";\n", name,
+                 db.typeIndex.at(type.name), name);
+    AppendFormat(out, "    typedef type_list<%s> bases;\n    static constexpr size_t field_count = %zu;\n", bases.c_str(), count);
+    AppendFormat(out, "    static constexpr auto fields = std::make_tuple(%s%s);\n};\n\n", count ? "\n" : "", fields.c_str());
+}
+
+// Unlike GenerateSource's output, the header is included wherever the
+// generated types are used: by the program's sources rather than compiled
+// on its own
+std::string GenerateHeader(const Database& db) {
+    // Every record gets a reflect, the tagged ones more
+    std::vector<const TypeInfo*> records;
+    std::vector<const TypeInfo*> soaTypes;
+    std::vector<const TypeInfo*> trackedTypes;
+    std::vector<std::string> includes;
+    for (const TypeInfo& type : db.types) {
+        if (type.kind != TypeKind::Record || !IsNameable(type.name))
+            continue;
+        records.push_back(&type);
+        if (HasAnnotation(type.annotations, "soa"))
+            soaTypes.push_back(&type);
+        if (HasAnnotation(type.annotations, "replicate"))
+            trackedTypes.push_back(&type);
+        includes.push_back(AbsolutePath(type.file));
+    }
+    std::sort(includes.begin(), includes.end());
+    includes.erase(std::unique(includes.begin(), includes.end()), includes.end());
+
+    std::string out = "// Generated by scan, do not edit.\n\n#pragma once\n\n";
+    if (!trackedTypes.empty())
+        out += "#include <prx/Delta.h>\n";
+    out += "#include <prx/Reflect.h>\n";
+    if (!soaTypes.empty())
+        out += "#include <prx/Soa.h>\n";
+    if (!includes.empty())
+        out += "\n";
+    for (const std::string& include : includes)
+        AppendFormat(&out, "#include \"%s\"\n", include.c_str());
+    if (!records.empty()) {
+        out += "\nnamespace prx {\n\n";
+        for (const TypeInfo* type : records)
+            GenerateReflect(&out, db, *type);
+        for (const TypeInfo* type : soaTypes)
+            GenerateSoaVector(&out, *type);
+        for (const TypeInfo* type : trackedTypes)
+            GenerateTracked(&out, *type);
+        out += "} // namespace prx\n";
+    }
+    return out;
+}
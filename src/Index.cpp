@@ -0,0 +1,77 @@
+// Alternative extraction backend built on libclang's indexing API. An index
+// action lives as long as its worker, and with
+// CXIndexOpt_SkipParsedBodiesInSession clang skips the function bodies of
+// headers the action has already seen in an earlier TU. Declarations arrive
+// through the indexDeclaration callback and go through the same extraction
+// code as the cursor walk, so both backends produce the same database.
+
+struct IndexState {
+    ExtractState extract;
+};
+
+// Batch TUs include their targets directly; this is where the CXFile for each
+// target is learned, since the TU doesn't exist yet while indexing runs.
+static CXIdxClientFile IndexIncludedFile(CXClientData data, const CXIdxIncludedFileInfo* include) {
+    IndexState* state = (IndexState*)data;
+    if (state->extract.files.size() > 1 && include->file) {
+        std::string path = AbsolutePath(ToString(clang_getFileName(include->file)));
+        for (size_t i = 0; i < state->extract.files.size(); i++) {
+            if (!state->extract.files[i] && state->extract.targets[i].path == path)
+                state->extract.files[i] = include->file;
+        }
+    }
+    return 0;
+}
+
+static void IndexDeclaration(CXClientData data, const CXIdxDeclInfo* decl) {
+    IndexState* state = (IndexState*)data;
+    // The indexer reports templates by their pattern, which the cursor walk
+    // never sees; their specializations come from the records using them
+    if (decl->entityInfo->templateKind == CXIdxEntity_Template || decl->entityInfo->templateKind == CXIdxEntity_TemplatePartialSpecialization)
+        return;
+    CXCursorKind kind = clang_getCursorKind(decl->cursor);
+    if (kind == CXCursor_StructDecl || kind == CXCursor_ClassDecl || kind == CXCursor_UnionDecl || kind == CXCursor_EnumDecl) {
+        if (!decl->isDefinition)
+            return;
+    } else if (kind != CXCursor_FunctionDecl && kind != CXCursor_VarDecl) {
+        return;
+    }
+    // Types nested in a record are extracted along with that record, or not at
+    // all when it isn't reflected, exactly as the cursor walk prunes them
+    CXCursor parent = clang_getCursorSemanticParent(decl->cursor);
+    switch (clang_getCursorKind(parent)) {
+    case CXCursor_StructDecl:
+    case CXCursor_ClassDecl:
+    case CXCursor_UnionDecl:
+    case CXCursor_ClassTemplate:
+    case CXCursor_ClassTemplatePartialSpecialization:
+    case CXCursor_FunctionDecl:
+    case CXCursor_CXXMethod:
+        return;
+    default:
+        break;
+    }
+    Database* db = FindTargetDatabase(&state->extract, clang_getCursorLocation(decl->cursor));
+    if (!db)
+        return;
+    RecordState recordState = { &state->extract, db, 0 };
+    VisitDecl(decl->cursor, parent, &recordState);
+}
+
+CXErrorCode IndexTranslationUnit(CXIndexAction action, TypeCache* types, const char* input, const char* const* argv, int argc,
+                                 CXUnsavedFile* unsavedFiles, unsigned unsavedCount, unsigned flags, const ExtractTarget* targets, size_t targetCount,
+                                 CXTranslationUnit* tu) {
+    IndexState state = {};
+    types->Clear();
+    state.extract.types = types;
+    state.extract.targets = targets;
+    state.extract.files.resize(targetCount);
+
+    IndexerCallbacks callbacks = {};
+    callbacks.ppIncludedFile = IndexIncludedFile;
+    callbacks.indexDeclaration = IndexDeclaration;
+    unsigned options = CXIndexOpt_SkipParsedBodiesInSession | CXIndexOpt_SuppressRedundantRefs;
+    *tu = 0;
+    return (CXErrorCode)clang_indexSourceFile(action, &state, &callbacks, sizeof(callbacks), options, input, argv, argc,
+                                              unsavedFiles, unsavedCount, tu, flags);
+}
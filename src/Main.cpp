@@ -1,25 +1,168 @@
 #include <clang-c/Index.h>
 #include <clang-c/CXString.h>
-#include <stdio.h>
-#include <stdlib.h>
-
-enum CXChildVisitResult visitor(CXCursor cursor, CXCursor parent, CXClientData data) {
-    CXSourceLocation location = clang_getCursorLocation( cursor );
-    if(!clang_Location_isFromMainFile(location))
-        return CXChildVisit_Continue;
-    CXString cxspelling = clang_getCursorSpelling(cursor);
-    const char* spelling = clang_getCString(cxspelling);
-    CXString cxkind = clang_getCursorKindSpelling(clang_getCursorKind(cursor));
-    const char* kind = clang_getCString(cxkind);
-    printf("Cursor spelling, kind: %s, %s\n", spelling, kind);
-    clang_disposeString(cxspelling);
-    clang_disposeString(cxkind);
-    return CXChildVisit_Recurse;
+#include <clang-c/Documentation.h>
+
+#include "Common.h"
+
+#include "Platform.cpp"
+#include "Database.cpp"
+#include "Cache.cpp"
+#include "Sources.cpp"
+#include "Preamble.cpp"
+#include "Extract.cpp"
+#include "Index.cpp"
+#include "Profile.cpp"
+#include "Scan.cpp"
+#include "Prefilter.cpp"
+#include "Batch.cpp"
+#include "Generate.cpp"
+#include "Driver.cpp"
+
+static void PrintUsage() {
+    fprintf(stderr,
+            "usage: scan [options] <inputs...> [-- <clang args...>]\n"
+            "  -o <file>    write the reflection database to <file> instead of dumping it\n"
+            "  --strip-cold leave source locations, doc comments and dependencies out of the -o database\n"
+            "  --dump <file>\n"
+            "               print the reflection database in <file> and exit\n"
+            "  -d <file>    write a Makefile dependency file for the -o and --generate outputs\n"
+            "  --generate <file>\n"
+            "               write C++ source with invoke thunks for the reflected functions\n"
+            "  --generate-header <file>\n"
+            "               write a C++ header with the generated types other sources include\n"
+            "  -j <n>       number of worker threads (default: hardware threads)\n"
+            "  --isolate    parse each translation unit in a child process\n"
+            "  --memory-budget <mb>\n"
+            "               limit the AST memory of parses in flight, lowering parallelism as needed\n"
+            "  --batch <n>  parse up to <n> headers together in one synthetic translation unit\n"
+            "  --share-preamble\n"
+            "               build the leading #include block shared by several inputs into a PCH once\n"
+            "  --pch-cache <dir>\n"
+            "               like --share-preamble, keeping the PCHs in <dir> across runs\n"
+            "  --marker <name>\n"
+            "               skip inputs that don't contain <name> (or any other --marker) without parsing\n"
+            "  --cache <file>\n"
+            "               remember per-input decisions between runs\n"
+            "  --backend <cursor|index>\n"
+            "               extract by walking cursors (default) or through clang_indexSourceFile\n"
+            "  --stats      print scan statistics\n"
+            "  --include-profile\n"
+            "               report which included headers the parse time and AST memory go to\n"
+            "  --stdin      read source buffers from stdin as '<size> <path>\\n<contents>' records\n"
+            "  --buffers <file>\n"
+            "               read source buffers from <file>, same format as --stdin\n"
+            "  --map <virtual>=<real>\n"
+            "               make <real> visible to clang as <virtual>\n"
+            "Source buffers shadow files on disk. Without inputs every buffer is scanned.\n");
 }
 
 int main(int argc, char** argv) {
-    CXIndex idx = clang_createIndex(1,1);
-    CXTranslationUnit tu = clang_createTranslationUnitFromSourceFile(idx, "sample.H", 0, 0, 0, 0);
-    clang_visitChildren(clang_getTranslationUnitCursor(tu), visitor, 0);
-    return 0;
+    ScanOptions options = {};
+    options.executablePath = GetExecutablePath(argv[0]);
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--") == 0) {
+            options.clangArgs.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (strcmp(arg, "-o") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else if (strcmp(arg, "--strip-cold") == 0) {
+            options.stripCold = true;
+        } else if (strcmp(arg, "--dump") == 0 && i + 1 < argc) {
+            options.dumpPath = argv[++i];
+        } else if (strcmp(arg, "-d") == 0 && i + 1 < argc) {
+            options.depfilePath = argv[++i];
+        } else if (strcmp(arg, "--generate") == 0 && i + 1 < argc) {
+            options.generatePath = argv[++i];
+        } else if (strcmp(arg, "--generate-header") == 0 && i + 1 < argc) {
+            options.generateHeaderPath = argv[++i];
+        } else if (strcmp(arg, "-j") == 0 && i + 1 < argc) {
+            options.threadCount = (u32)atoi(argv[++i]);
+        } else if (strcmp(arg, "--memory-budget") == 0 && i + 1 < argc) {
+            options.memoryBudget = (u64)strtoull(argv[++i], 0, 10) << 20;
+        } else if (strcmp(arg, "--batch") == 0 && i + 1 < argc) {
+            options.batchSize = (u32)atoi(argv[++i]);
+        } else if (strcmp(arg, "--share-preamble") == 0) {
+            options.sharePreamble = true;
+        } else if (strcmp(arg, "--pch-cache") == 0 && i + 1 < argc) {
+            options.sharePreamble = true;
+            options.pchCacheDir = argv[++i];
+        } else if (strcmp(arg, "--marker") == 0 && i + 1 < argc) {
+            options.markers.push_back(argv[++i]);
+        } else if (strcmp(arg, "--cache") == 0 && i + 1 < argc) {
+            options.cachePath = argv[++i];
+        } else if (strcmp(arg, "--backend") == 0 && i + 1 < argc) {
+            const char* backend = argv[++i];
+            if (strcmp(backend, "index") == 0) {
+                options.indexBackend = true;
+            } else if (strcmp(backend, "cursor") != 0) {
+                fprintf(stderr, "scan: unknown backend %s\n", backend);
+                return 2;
+            }
+        } else if (strcmp(arg, "--include-profile") == 0) {
+            options.includeProfile = true;
+        } else if (strcmp(arg, "--stats") == 0) {
+            options.printStats = true;
+        } else if (strcmp(arg, "--stdin") == 0) {
+            SetStdinBinary();
+            if (!ReadSourceBuffers(stdin, &options.buffers)) {
+                fprintf(stderr, "scan: malformed source buffers on stdin\n");
+                return 2;
+            }
+        } else if (strcmp(arg, "--buffers") == 0 && i + 1 < argc) {
+            if (!ReadSourceBuffersFile(argv[++i], &options.buffers)) {
+                fprintf(stderr, "scan: failed to read source buffers from %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--map") == 0 && i + 1 < argc) {
+            const char* mapping = argv[++i];
+            const char* separator = strchr(mapping, '=');
+            if (!separator) {
+                fprintf(stderr, "scan: --map expects <virtual>=<real>\n");
+                return 2;
+            }
+            options.mappings.push_back({ std::string(mapping, separator), std::string(separator + 1) });
+        } else if (strcmp(arg, "--isolate") == 0) {
+            options.isolate = true;
+        } else if (strcmp(arg, "--worker") == 0) {
+            options.worker = true;
+        } else if (strcmp(arg, "--reduced") == 0) {
+            options.reduced = true;
+        } else if (arg[0] == '-') {
+            fprintf(stderr, "scan: unknown option %s\n", arg);
+            PrintUsage();
+            return 2;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    // Turns the markers in prx/Annotations.h into annotate attributes
+    options.clangArgs.insert(options.clangArgs.begin(), "-DPRX_SCANNER");
+
+    if (options.inputs.empty()) {
+        for (const SourceBuffer& buffer : options.buffers)
+            options.inputs.push_back(buffer.path);
+    } else if (!options.buffers.empty()) {
+        // Buffers are keyed by absolute path; includes relative to a TU only
+        // find them when the TU itself is named by its absolute path
+        for (std::string& input : options.inputs)
+            input = AbsolutePath(input);
+    }
+
+    if (options.worker)
+        return RunWorker(options);
+    if (!options.dumpPath.empty())
+        return DumpDatabaseFile(options);
+
+    if (options.inputs.empty()) {
+        PrintUsage();
+        return 2;
+    }
+    if (!options.depfilePath.empty() && options.outputPath.empty() && options.generatePath.empty() && options.generateHeaderPath.empty()) {
+        fprintf(stderr, "scan: -d needs -o, --generate or --generate-header\n");
+        return 2;
+    }
+    return RunScan(options);
 }
@@ -0,0 +1,314 @@
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+#include <chrono>
+#include <filesystem>
+
+struct ProcessResult {
+    bool started;
+    bool crashed;
+    i32 exitCode;
+};
+
+std::string GetExecutablePath(const char* argv0) {
+#if defined(_WIN32)
+    char buffer[MAX_PATH];
+    DWORD length = GetModuleFileNameA(0, buffer, MAX_PATH);
+    if (length > 0 && length < MAX_PATH)
+        return std::string(buffer, length);
+#else
+    char buffer[4096];
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+    if (length > 0 && length < (ssize_t)sizeof(buffer))
+        return std::string(buffer, (size_t)length);
+#endif
+    return argv0;
+}
+
+static u32 CurrentProcessId() {
+#if defined(_WIN32)
+    return (u32)GetCurrentProcessId();
+#else
+    return (u32)getpid();
+#endif
+}
+
+std::string MakeTempPath(const char* prefix, u32 index) {
+    std::error_code error;
+    std::filesystem::path dir = std::filesystem::temp_directory_path(error);
+    if (error)
+        dir = ".";
+    char name[128];
+    snprintf(name, sizeof(name), "%s-%u-%u.tmp", prefix, CurrentProcessId(), index);
+    return (dir / name).string();
+}
+
+// A name next to path for writing it under before renaming it into place,
+// unique to this process
+std::string MakeSiblingTempPath(const std::string& path) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%u.tmp", CurrentProcessId());
+    return path + suffix;
+}
+
+// Replaces to if it exists
+bool RenameFile(const char* from, const char* to) {
+    std::error_code error;
+    std::filesystem::rename(from, to, error);
+    return !error;
+}
+
+bool ReadEntireFile(const char* path, std::vector<u8>* out) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bool ok = size >= 0;
+    if (ok) {
+        out->resize((size_t)size);
+        ok = size == 0 || fread(out->data(), (size_t)size, 1, file) == 1;
+    }
+    fclose(file);
+    return ok;
+}
+
+// Reads up to size bytes at offset, *read is less at the end of the file
+bool ReadFileRange(const char* path, u64 offset, size_t size, void* out, size_t* read) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    bool ok = fseek(file, (long)offset, SEEK_SET) == 0;
+    if (ok) {
+        *read = fread(out, 1, size, file);
+        ok = !ferror(file);
+    }
+    fclose(file);
+    return ok;
+}
+
+bool WriteEntireFile(const char* path, const void* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    bool ok = size == 0 || fwrite(data, size, 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+void RemoveFile(const char* path) {
+    remove(path);
+}
+
+// Writes a temporary and renames it over path, so a reader in another
+// process sees either the old content or all of the new
+bool WriteFileAtomic(const char* path, const void* data, size_t size) {
+    std::string temp = MakeSiblingTempPath(path);
+    if (WriteEntireFile(temp.c_str(), data, size) && RenameFile(temp.c_str(), path))
+        return true;
+    RemoveFile(temp.c_str());
+    return false;
+}
+
+// Leaves the file alone when it already holds exactly these bytes, so its
+// timestamp only moves when the content does and a no-op rescan doesn't
+// trigger the build steps that depend on it. Otherwise it is replaced
+// atomically.
+bool WriteFileIfChanged(const char* path, const void* data, size_t size) {
+    std::vector<u8> existing;
+    if (ReadEntireFile(path, &existing) && existing.size() == size && memcmp(existing.data(), data, size) == 0)
+        return true;
+    return WriteFileAtomic(path, data, size);
+}
+
+bool GetFileInfo(const char* path, u64* size, u64* modifyTime) {
+    std::error_code error;
+    std::filesystem::path p(path);
+    *size = (u64)std::filesystem::file_size(p, error);
+    if (error)
+        return false;
+    *modifyTime = (u64)std::filesystem::last_write_time(p, error).time_since_epoch().count();
+    return !error;
+}
+
+// Read-only view of a whole file. Empty files map to a null view.
+struct MappedFile {
+    const u8* data;
+    size_t size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+bool MapFile(const char* path, MappedFile* mapped) {
+    *mapped = {};
+#if defined(_WIN32)
+    mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (mapped->file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapped->file, &size)) {
+        CloseHandle(mapped->file);
+        return false;
+    }
+    mapped->size = (size_t)size.QuadPart;
+    if (mapped->size == 0)
+        return true;
+    mapped->mapping = CreateFileMappingA(mapped->file, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapped->mapping)
+        mapped->data = (const u8*)MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mapped->data) {
+        if (mapped->mapping)
+            CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        return false;
+    }
+#else
+    mapped->fd = open(path, O_RDONLY);
+    if (mapped->fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(mapped->fd, &info) != 0) {
+        close(mapped->fd);
+        return false;
+    }
+    mapped->size = (size_t)info.st_size;
+    if (mapped->size == 0)
+        return true;
+    void* data = mmap(0, mapped->size, PROT_READ, MAP_PRIVATE, mapped->fd, 0);
+    if (data == MAP_FAILED) {
+        close(mapped->fd);
+        return false;
+    }
+    madvise(data, mapped->size, MADV_SEQUENTIAL);
+    mapped->data = (const u8*)data;
+#endif
+    return true;
+}
+
+void UnmapFile(MappedFile* mapped) {
+#if defined(_WIN32)
+    if (mapped->data)
+        UnmapViewOfFile(mapped->data);
+    if (mapped->mapping)
+        CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+#else
+    if (mapped->data)
+        munmap((void*)mapped->data, mapped->size);
+    close(mapped->fd);
+#endif
+    *mapped = {};
+}
+
+#if defined(_WIN32)
+static void AppendQuotedArgument(std::string* commandLine, const std::string& arg) {
+    if (!commandLine->empty())
+        commandLine->push_back(' ');
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+        commandLine->append(arg);
+        return;
+    }
+    commandLine->push_back('"');
+    size_t backslashes = 0;
+    for (char c : arg) {
+        if (c == '\\') {
+            backslashes++;
+            continue;
+        }
+        if (c == '"')
+            commandLine->append(backslashes * 2 + 1, '\\');
+        else
+            commandLine->append(backslashes, '\\');
+        backslashes = 0;
+        commandLine->push_back(c);
+    }
+    commandLine->append(backslashes * 2, '\\');
+    commandLine->push_back('"');
+}
+#endif
+
+// Runs a process to completion. A child that dies from an unhandled exception
+// or a signal is reported as crashed rather than as a regular exit code.
+ProcessResult RunProcess(const std::vector<std::string>& args) {
+    ProcessResult result = {};
+    if (args.empty())
+        return result;
+#if defined(_WIN32)
+    std::string commandLine;
+    for (const std::string& arg : args)
+        AppendQuotedArgument(&commandLine, arg);
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION process = {};
+    // Keep crashing workers from popping up the Windows Error Reporting dialog
+    UINT oldMode = SetErrorMode(SEM_FAILCRITICALERRORS | SEM_NOGPFAULTERRORBOX);
+    BOOL created = CreateProcessA(args[0].c_str(), &commandLine[0], 0, 0, TRUE, 0, 0, 0, &startup, &process);
+    SetErrorMode(oldMode);
+    if (!created)
+        return result;
+    result.started = true;
+    WaitForSingleObject(process.hProcess, INFINITE);
+    DWORD exitCode = 0;
+    GetExitCodeProcess(process.hProcess, &exitCode);
+    CloseHandle(process.hThread);
+    CloseHandle(process.hProcess);
+    // NTSTATUS error codes (access violation, stack overflow, ...) have the top bits set
+    result.crashed = (exitCode & 0xC0000000) == 0xC0000000;
+    result.exitCode = (i32)exitCode;
+#else
+    std::vector<char*> argv;
+    for (const std::string& arg : args)
+        argv.push_back((char*)arg.c_str());
+    argv.push_back(0);
+
+    pid_t pid;
+    if (posix_spawn(&pid, args[0].c_str(), 0, 0, argv.data(), environ) != 0)
+        return result;
+    result.started = true;
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            result.crashed = true;
+            return result;
+        }
+    }
+    if (WIFSIGNALED(status)) {
+        result.crashed = true;
+        result.exitCode = -WTERMSIG(status);
+    } else {
+        result.exitCode = WEXITSTATUS(status);
+    }
+#endif
+    return result;
+}
+
+f64 GetTimeSeconds() {
+    using namespace std::chrono;
+    return duration<f64>(steady_clock::now().time_since_epoch()).count();
+}
+
+void SetStdinBinary() {
+#if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+}
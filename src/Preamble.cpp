@@ -0,0 +1,352 @@
+// Shared preambles. Inputs usually start with the same block of #includes;
+// that block is compiled once into a PCH that every TU starting with it loads
+// through -include-pch. The prefix headers are then skipped by their include
+// guards when the TU includes them again, so only prefixes made of guarded
+// headers are shared.
+//
+// libclang's own preamble (CXTranslationUnit_PrecompiledPreamble) belongs to
+// one TU and only pays off when that TU is reparsed, so it can't be shared
+// between the inputs of a scan; an explicit PCH can.
+//
+// PCHs are keyed by the clang flags, the prefix and the contents of the
+// headers it includes directly. clang validates the rest of the dependencies
+// when it loads a PCH; a TU whose PCH fails to load is parsed again without
+// it and the PCH is dropped for the rest of the scan.
+
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+
+struct LeadingIncludes {
+    std::vector<std::string> lines;
+    bool guarded;
+};
+
+// The #include lines a source starts with, skipping comments, blank lines and
+// the include guard.
+LeadingIncludes CollectLeadingIncludes(const std::string& source) {
+    LeadingIncludes result = {};
+    std::string guard;
+    bool inComment = false;
+    size_t at = 0;
+    while (at < source.size()) {
+        size_t end = source.find('\n', at);
+        if (end == std::string::npos)
+            end = source.size();
+        std::string line = source.substr(at, end - at);
+        at = end + 1;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (inComment) {
+            size_t close = line.find("*/");
+            if (close == std::string::npos)
+                continue;
+            inComment = false;
+            line = line.substr(close + 2);
+        }
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line.compare(first, 2, "//") == 0)
+            continue;
+        if (line.compare(first, 2, "/*") == 0) {
+            if (line.find("*/", first + 2) == std::string::npos)
+                inComment = true;
+            continue;
+        }
+        if (line[first] != '#')
+            break;
+
+        size_t i = line.find_first_not_of(" \t", first + 1);
+        if (i == std::string::npos)
+            continue;
+        size_t keywordEnd = i;
+        while (keywordEnd < line.size() && IsIdentifierChar(line[keywordEnd]))
+            keywordEnd++;
+        std::string directive = line.substr(i, keywordEnd - i);
+        size_t argBegin = line.find_first_not_of(" \t", keywordEnd);
+        std::string arg = argBegin == std::string::npos ? std::string() : line.substr(argBegin);
+        while (!arg.empty() && (arg.back() == ' ' || arg.back() == '\t'))
+            arg.pop_back();
+
+        if (directive == "include") {
+            result.lines.push_back(arg);
+        } else if (directive == "pragma" && arg == "once" && result.lines.empty()) {
+            result.guarded = true;
+        } else if (directive == "ifndef" && guard.empty() && result.lines.empty()) {
+            guard = arg;
+        } else if (directive == "define" && !guard.empty() && arg == guard) {
+            result.guarded = true;
+        } else {
+            break;
+        }
+    }
+    return result;
+}
+
+static bool IsGuardedHeader(const std::string& source) {
+    return CollectLeadingIncludes(source).guarded;
+}
+
+std::vector<std::string> CollectIncludeDirs(const std::vector<std::string>& args) {
+    static const char* prefixes[] = { "-I", "-isystem", "-iquote" };
+    std::vector<std::string> dirs;
+    for (size_t i = 0; i < args.size(); i++) {
+        for (u32 p = 0; p < ArrayCount(prefixes); p++) {
+            size_t length = strlen(prefixes[p]);
+            if (args[i].compare(0, length, prefixes[p]) != 0)
+                continue;
+            if (args[i].size() > length)
+                dirs.push_back(args[i].substr(length));
+            else if (i + 1 < args.size())
+                dirs.push_back(args[++i]);
+            break;
+        }
+    }
+    return dirs;
+}
+
+// Finds the file an #include line names, the way clang would for the common
+// cases. Headers that can't be found (usually system headers) are left to
+// clang and only contribute their spelling to the PCH key.
+static bool ResolveInclude(const std::string& line, const std::string& includerDir, const std::vector<std::string>& includeDirs, std::string* path) {
+    if (line.size() < 2)
+        return false;
+    char close = line[0] == '"' ? '"' : line[0] == '<' ? '>' : 0;
+    size_t end = close ? line.find(close, 1) : std::string::npos;
+    if (end == std::string::npos)
+        return false;
+    std::string name = line.substr(1, end - 1);
+    std::vector<std::string> candidates;
+    if (close == '"')
+        candidates.push_back((std::filesystem::path(includerDir) / name).string());
+    for (const std::string& dir : includeDirs)
+        candidates.push_back((std::filesystem::path(dir) / name).string());
+    for (const std::string& candidate : candidates) {
+        std::error_code error;
+        if (std::filesystem::is_regular_file(candidate, error)) {
+            *path = AbsolutePath(candidate);
+            return true;
+        }
+    }
+    return false;
+}
+
+enum struct PreambleState {
+    Pending,
+    Building,
+    Ready,
+    Failed,
+};
+
+struct Preamble {
+    PreambleState state;
+    std::string headerPath;
+    std::string pchPath;
+    std::string source;
+    u32 users;
+};
+
+struct PreambleCache {
+    std::mutex mutex;
+    std::condition_variable built;
+    std::unordered_map<u64, Preamble> preambles;
+    std::unordered_map<std::string, u64> keyOfInput;
+    std::string directory;
+    bool persistent;
+    u32 builds;
+    u32 failedBuilds;
+    u32 hits;
+    f64 buildSeconds;
+};
+
+// Picks, for every input, the longest leading include block it shares with
+// at least one other input, and derives the PCH key for it.
+void PlanPreambles(PreambleCache* cache, const std::vector<std::string>& inputs, const std::vector<SourceBuffer>& buffers, const std::vector<std::string>& clangArgs) {
+    std::vector<std::string> includeDirs = CollectIncludeDirs(clangArgs);
+    u64 flagsHash = 0xcbf29ce484222325ull;
+    for (const std::string& arg : clangArgs)
+        flagsHash = HashString(arg, flagsHash);
+
+    struct Prefix {
+        std::vector<std::string> lines;
+        std::string dir;
+        std::string extension;
+    };
+    std::vector<Prefix> prefixes(inputs.size());
+    std::unordered_map<std::string, u32> prefixCounts;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        std::string source;
+        if (!LoadSource(buffers, inputs[i], &source))
+            continue;
+        std::filesystem::path path(AbsolutePath(inputs[i]));
+        Prefix* prefix = &prefixes[i];
+        prefix->dir = path.parent_path().string();
+        prefix->extension = path.extension().string();
+        // Includes are keyed by the absolute path they resolve to, so TUs in
+        // different directories still share a prefix when they mean the same headers
+        for (const std::string& line : CollectLeadingIncludes(source).lines) {
+            std::string resolved;
+            std::string header;
+            if (!ResolveInclude(line, prefix->dir, includeDirs, &resolved)) {
+                // A header clang may find somewhere else can't be checked for a guard
+                if (line[0] == '"')
+                    break;
+                prefix->lines.push_back(line);
+                continue;
+            }
+            if (!LoadSource(buffers, resolved, &header) || !IsGuardedHeader(header))
+                break;
+            prefix->lines.push_back("\"" + resolved + "\"");
+        }
+        std::string key = prefix->extension;
+        for (const std::string& line : prefix->lines) {
+            key += "\n" + line;
+            prefixCounts[key]++;
+        }
+    }
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        Prefix* prefix = &prefixes[i];
+        std::string key = prefix->extension;
+        size_t shared = 0;
+        for (size_t l = 0; l < prefix->lines.size(); l++) {
+            key += "\n" + prefix->lines[l];
+            if (prefixCounts[key] < 2)
+                break;
+            shared = l + 1;
+        }
+        if (shared == 0)
+            continue;
+
+        std::string source;
+        u64 hash = HashString(prefix->extension, flagsHash);
+        for (size_t l = 0; l < shared; l++) {
+            const std::string& line = prefix->lines[l];
+            source += "#include " + line + "\n";
+            hash = HashString(line, hash);
+            std::string header;
+            if (line[0] == '"' && LoadSource(buffers, line.substr(1, line.size() - 2), &header))
+                hash = HashString(header, hash);
+        }
+        cache->keyOfInput[AbsolutePath(inputs[i])] = hash;
+        Preamble* preamble = &cache->preambles[hash];
+        if (preamble->users++ == 0) {
+            char name[64];
+            snprintf(name, sizeof(name), "prefix-%016llx", (unsigned long long)hash);
+            std::filesystem::path base = std::filesystem::path(cache->directory) / name;
+            preamble->state = PreambleState::Pending;
+            preamble->headerPath = base.string() + prefix->extension;
+            preamble->pchPath = base.string() + ".pch";
+            preamble->source = std::move(source);
+        }
+    }
+
+    // A prefix only one input uses isn't worth a PCH
+    for (auto it = cache->keyOfInput.begin(); it != cache->keyOfInput.end();) {
+        if (cache->preambles[it->second].users < 2)
+            it = cache->keyOfInput.erase(it);
+        else
+            ++it;
+    }
+}
+
+static bool BuildPreamble(Preamble* preamble, CXIndex index, const std::vector<std::string>& args, const std::vector<CXUnsavedFile>& unsavedFiles) {
+    // The prefix header is written out rather than passed as an unsaved file:
+    // clang checks every input of a PCH against the disk when loading it.
+    // Another scan sharing the PCH cache may be loading a PCH built on the
+    // same header, which is only touched when it isn't there yet.
+    if (!WriteFileIfChanged(preamble->headerPath.c_str(), preamble->source.data(), preamble->source.size()))
+        return false;
+    std::vector<const char*> argv;
+    for (const std::string& arg : args)
+        argv.push_back(arg.c_str());
+    unsigned flags = CXTranslationUnit_ForSerialization | CXTranslationUnit_Incomplete;
+    CXTranslationUnit tu = 0;
+    CXErrorCode error = clang_parseTranslationUnit2(index, preamble->headerPath.c_str(), argv.data(), (int)argv.size(),
+                                                    (CXUnsavedFile*)unsavedFiles.data(), (unsigned)unsavedFiles.size(), flags, &tu);
+    if (error != CXError_Success || !tu)
+        return false;
+    bool ok = true;
+    unsigned count = clang_getNumDiagnostics(tu);
+    for (unsigned i = 0; i < count && ok; i++) {
+        CXDiagnostic diagnostic = clang_getDiagnostic(tu, i);
+        ok = clang_getDiagnosticSeverity(diagnostic) < CXDiagnostic_Error;
+        clang_disposeDiagnostic(diagnostic);
+    }
+    // Saved under a temporary name, a PCH under its own name is complete
+    std::string temp = MakeSiblingTempPath(preamble->pchPath);
+    if (ok)
+        ok = clang_saveTranslationUnit(tu, temp.c_str(), clang_defaultSaveOptions(tu)) == CXSaveError_None;
+    clang_disposeTranslationUnit(tu);
+    if (ok)
+        ok = RenameFile(temp.c_str(), preamble->pchPath.c_str());
+    if (!ok)
+        RemoveFile(temp.c_str());
+    return ok;
+}
+
+// Returns the PCH to parse an input with, or null if it has none. The first
+// worker to ask for a preamble builds it while the others wait for it.
+const char* AcquirePreamble(PreambleCache* cache, CXIndex index, const std::string& input, const std::vector<std::string>& args, const std::vector<CXUnsavedFile>& unsavedFiles) {
+    std::unique_lock<std::mutex> lock(cache->mutex);
+    auto key = cache->keyOfInput.find(AbsolutePath(input));
+    if (key == cache->keyOfInput.end())
+        return 0;
+    Preamble* preamble = &cache->preambles[key->second];
+    if (preamble->state == PreambleState::Pending) {
+        preamble->state = PreambleState::Building;
+        lock.unlock();
+        // The key covers the prefix and its headers, so a PCH left by an
+        // earlier run with the same key can be loaded as is
+        std::error_code error;
+        bool ok = cache->persistent && std::filesystem::exists(preamble->pchPath, error);
+        f64 seconds = 0;
+        if (!ok) {
+            f64 start = GetTimeSeconds();
+            ok = BuildPreamble(preamble, index, args, unsavedFiles);
+            seconds = GetTimeSeconds() - start;
+        }
+        lock.lock();
+        if (seconds > 0) {
+            cache->builds++;
+            cache->buildSeconds += seconds;
+        }
+        preamble->state = ok ? PreambleState::Ready : PreambleState::Failed;
+        if (!ok)
+            cache->failedBuilds++;
+        cache->built.notify_all();
+    } else if (preamble->state == PreambleState::Building) {
+        cache->built.wait(lock, [preamble]() { return preamble->state != PreambleState::Building; });
+    }
+    if (preamble->state != PreambleState::Ready)
+        return 0;
+    cache->hits++;
+    return preamble->pchPath.c_str();
+}
+
+// Called when a TU fails to parse with its PCH, typically because a header
+// behind the prefix changed since the PCH was built. The PCH is dropped so
+// the remaining TUs don't trip over it too.
+void RejectPreamble(PreambleCache* cache, const std::string& input) {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    auto key = cache->keyOfInput.find(AbsolutePath(input));
+    if (key == cache->keyOfInput.end())
+        return;
+    Preamble* preamble = &cache->preambles[key->second];
+    if (preamble->state == PreambleState::Ready) {
+        preamble->state = PreambleState::Failed;
+        cache->failedBuilds++;
+        // A PCH in the shared --pch-cache directory may be loading in another
+        // scan right now, so it is only dropped for this one
+        if (!cache->persistent)
+            RemoveFile(preamble->pchPath.c_str());
+    }
+}
+
+// Without --pch-cache the PCHs live in a directory of this process's own
+void CleanupPreambles(PreambleCache* cache) {
+    if (cache->persistent || cache->directory.empty())
+        return;
+    std::error_code error;
+    std::filesystem::remove_all(cache->directory, error);
+}
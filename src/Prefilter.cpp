@@ -0,0 +1,89 @@
+// Lexical pre-filter. Only declarations tagged with a reflection marker are
+// of interest, so an input whose text doesn't contain any marker name can't
+// produce anything and is skipped without a parse. The check is a plain
+// substring search over the memory-mapped file; memchr in the CRT is
+// vectorized, which makes this run at memory bandwidth. A marker inside a
+// comment or a longer identifier still counts as a match, which only costs
+// a parse that wasn't needed.
+
+struct PrefilterStats {
+    u64 bytesScanned;
+    f64 seconds;
+    u32 filesScanned;
+    u32 skipped;
+    u32 cached;
+};
+
+bool ContainsMarker(const u8* data, size_t size, const std::vector<std::string>& markers) {
+    for (const std::string& marker : markers) {
+        if (marker.empty() || marker.size() > size)
+            continue;
+        const u8* at = data;
+        const u8* last = data + size - marker.size();
+        u8 first = (u8)marker[0];
+        while (at <= last) {
+            at = (const u8*)memchr(at, first, (size_t)(last - at) + 1);
+            if (!at)
+                break;
+            if (memcmp(at, marker.data(), marker.size()) == 0)
+                return true;
+            at++;
+        }
+    }
+    return false;
+}
+
+static bool InputHasMarkers(const ScanOptions& options, const std::string& input, u64 markersHash, ScanCache* cache, PrefilterStats* stats) {
+    std::string absolute = AbsolutePath(input);
+    for (const SourceBuffer& buffer : options.buffers) {
+        if (buffer.path == absolute) {
+            stats->filesScanned++;
+            stats->bytesScanned += buffer.contents.size();
+            return ContainsMarker((const u8*)buffer.contents.data(), buffer.contents.size(), options.markers);
+        }
+    }
+
+    CacheEntry entry = {};
+    bool haveInfo = GetFileInfo(input.c_str(), &entry.size, &entry.modifyTime);
+    if (haveInfo && cache) {
+        auto it = cache->entries.find(absolute);
+        if (it != cache->entries.end() && it->second.size == entry.size && it->second.modifyTime == entry.modifyTime && it->second.markersHash == markersHash) {
+            stats->cached++;
+            return it->second.hasMarkers;
+        }
+    }
+
+    MappedFile file;
+    // Let the parse report files we can't read
+    if (!MapFile(input.c_str(), &file))
+        return true;
+    bool found = ContainsMarker(file.data, file.size, options.markers);
+    stats->filesScanned++;
+    stats->bytesScanned += file.size;
+    UnmapFile(&file);
+
+    if (haveInfo && cache) {
+        entry.markersHash = markersHash;
+        entry.hasMarkers = found;
+        cache->entries[absolute] = entry;
+        cache->dirty = true;
+    }
+    return found;
+}
+
+// Returns for each input whether it has to be parsed.
+std::vector<bool> PrefilterInputs(const ScanOptions& options, ScanCache* cache, PrefilterStats* stats) {
+    f64 start = GetTimeSeconds();
+    u64 markersHash = 0xcbf29ce484222325ull;
+    for (const std::string& marker : options.markers)
+        markersHash = HashString(marker, markersHash);
+
+    std::vector<bool> keep(options.inputs.size());
+    for (size_t i = 0; i < options.inputs.size(); i++) {
+        keep[i] = InputHasMarkers(options, options.inputs[i], markersHash, cache, stats);
+        if (!keep[i])
+            stats->skipped++;
+    }
+    stats->seconds = GetTimeSeconds() - start;
+    return keep;
+}
@@ -0,0 +1,133 @@
+// Include profile: which headers the scan spends its time on. libclang has no
+// per-header timings, so each TU's parse time and AST memory are split among
+// the files it includes in proportion to their source size. A header's
+// exclusive cost is its own share, its inclusive cost adds the shares of
+// everything it pulls in.
+
+#include <mutex>
+
+struct HeaderCost {
+    u32 tus;
+    f64 exclusiveSeconds;
+    f64 inclusiveSeconds;
+    f64 exclusiveMemory;
+    f64 inclusiveMemory;
+};
+
+struct IncludeProfile {
+    std::mutex mutex;
+    std::unordered_map<std::string, HeaderCost> headers;
+    u32 tus;
+    f64 seconds;
+};
+
+struct ProfileFile {
+    CXFile file;
+    // Index of the file that first included this one, -1 for the main file
+    i64 includer;
+    size_t size;
+};
+
+struct FileIdHash {
+    size_t operator()(const CXFileUniqueID& id) const { return (size_t)HashBytes(id.data, sizeof(id.data)); }
+};
+
+struct FileIdEqual {
+    bool operator()(const CXFileUniqueID& a, const CXFileUniqueID& b) const { return memcmp(a.data, b.data, sizeof(a.data)) == 0; }
+};
+
+// The files of a TU in inclusion order, indexed by file identity: a TU that
+// includes thousands of headers can't afford a linear search per inclusion
+struct ProfileFiles {
+    std::vector<ProfileFile> files;
+    std::unordered_map<CXFileUniqueID, size_t, FileIdHash, FileIdEqual> indices;
+};
+
+// What clang_File_isEqual compares; a file without one is told apart by its
+// handle
+static CXFileUniqueID ProfileFileId(CXFile file) {
+    CXFileUniqueID id;
+    if (clang_getFileUniqueID(file, &id) != 0) {
+        id.data[0] = (unsigned long long)(uintptr_t)file;
+        id.data[1] = 0;
+        id.data[2] = ~0ull;
+    }
+    return id;
+}
+
+static void CollectProfileFile(CXFile file, CXSourceLocation* stack, unsigned depth, CXClientData data) {
+    ProfileFiles* files = (ProfileFiles*)data;
+    auto inserted = files->indices.emplace(ProfileFileId(file), files->files.size());
+    if (!inserted.second)
+        return;
+    i64 includer = -1;
+    if (depth > 0) {
+        CXFile includerFile;
+        clang_getFileLocation(stack[0], &includerFile, 0, 0, 0);
+        auto it = files->indices.find(ProfileFileId(includerFile));
+        if (it != files->indices.end())
+            includer = (i64)it->second;
+    }
+    files->files.push_back({ file, includer, 0 });
+}
+
+void RecordIncludeProfile(IncludeProfile* profile, CXTranslationUnit tu, f64 seconds, u64 memory) {
+    ProfileFiles collected;
+    clang_getInclusions(tu, CollectProfileFile, &collected);
+    std::vector<ProfileFile>& files = collected.files;
+    size_t totalSize = 0;
+    for (ProfileFile& file : files) {
+        clang_getFileContents(tu, file.file, &file.size);
+        totalSize += file.size;
+    }
+    if (totalSize == 0)
+        return;
+
+    // Includers come before what they include, so one backward pass adds every
+    // file's inclusive share to its includer
+    std::vector<f64> exclusive(files.size());
+    std::vector<f64> inclusive(files.size());
+    for (size_t i = 0; i < files.size(); i++)
+        exclusive[i] = inclusive[i] = (f64)files[i].size / totalSize;
+    for (size_t i = files.size(); i-- > 0;) {
+        if (files[i].includer >= 0)
+            inclusive[(size_t)files[i].includer] += inclusive[i];
+    }
+
+    std::lock_guard<std::mutex> lock(profile->mutex);
+    profile->tus++;
+    profile->seconds += seconds;
+    for (size_t i = 0; i < files.size(); i++) {
+        // The main file is an input or a synthetic batch TU, not a header
+        if (files[i].includer < 0)
+            continue;
+        HeaderCost* cost = &profile->headers[AbsolutePath(ToString(clang_getFileName(files[i].file)))];
+        cost->tus++;
+        cost->exclusiveSeconds += exclusive[i] * seconds;
+        cost->inclusiveSeconds += inclusive[i] * seconds;
+        cost->exclusiveMemory += exclusive[i] * memory;
+        cost->inclusiveMemory += inclusive[i] * memory;
+    }
+}
+
+// Headers by inclusive time. Removing a header saves its inclusive time;
+// precompiling it saves all but one TU's worth of it, which is what the
+// "pch saves" column shows.
+void PrintIncludeProfile(IncludeProfile* profile, u32 limit, FILE* out) {
+    std::vector<std::pair<std::string, HeaderCost>> headers(profile->headers.begin(), profile->headers.end());
+    std::sort(headers.begin(), headers.end(), [](const std::pair<std::string, HeaderCost>& a, const std::pair<std::string, HeaderCost>& b) {
+        if (a.second.inclusiveSeconds != b.second.inclusiveSeconds)
+            return a.second.inclusiveSeconds > b.second.inclusiveSeconds;
+        return a.first < b.first;
+    });
+    fprintf(out, "scan: include profile of %u translation units, %.2fs parsing, %zu headers\n", profile->tus, profile->seconds, headers.size());
+    fprintf(out, "   incl s   excl s  pch saves   incl MB   excl MB    TUs  header\n");
+    for (size_t i = 0; i < headers.size() && i < limit; i++) {
+        const HeaderCost& cost = headers[i].second;
+        f64 pchSaves = cost.inclusiveSeconds - cost.inclusiveSeconds / cost.tus;
+        fprintf(out, "%9.2f%9.2f%11.2f%10.1f%10.1f%7u  %s\n", cost.inclusiveSeconds, cost.exclusiveSeconds, pchSaves,
+                cost.inclusiveMemory / (1 << 20), cost.exclusiveMemory / (1 << 20), cost.tus, headers[i].first.c_str());
+    }
+    if (headers.size() > limit)
+        fprintf(out, "  ... %zu more\n", headers.size() - limit);
+}
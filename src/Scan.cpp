@@ -0,0 +1,349 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct ScanOptions {
+    std::vector<std::string> inputs;
+    std::vector<std::string> clangArgs;
+    // Sources passed as CXUnsavedFile, they shadow files on disk
+    std::vector<SourceBuffer> buffers;
+    // Virtual paths mapped onto real files through a VFS overlay
+    std::vector<FileMapping> mappings;
+    std::string outputPath;
+    // Leave the source locations and doc comments out of outputPath
+    bool stripCold;
+    // Dump this database instead of scanning
+    std::string dumpPath;
+    std::string executablePath;
+    u32 threadCount;
+    // Upper bound for the AST memory of all in-flight parses, 0 = unlimited
+    u64 memoryBudget;
+    // Headers per synthetic batch TU, 0 or 1 = parse every input alone
+    u32 batchSize;
+    // Build the leading include block shared by several inputs into a PCH
+    bool sharePreamble;
+    // Keep shared preamble PCHs here across runs instead of in a temp dir
+    std::string pchCacheDir;
+    // Extract through clang_indexSourceFile instead of walking the cursors
+    bool indexBackend;
+    // Names whose presence marks a file as having something to reflect.
+    // Inputs that contain none of them are skipped without parsing.
+    std::vector<std::string> markers;
+    // Scan cache file, see Cache.cpp
+    std::string cachePath;
+    // C++ source with invoke thunks, see Generate.cpp
+    std::string generatePath;
+    // C++ header with the generated code other translation units include
+    std::string generateHeaderPath;
+    // Makefile-style dependency file listing the inputs and every header
+    // they include, as the dependencies of the outputs above
+    std::string depfilePath;
+    bool printStats;
+    // Attribute parse time and AST memory to the included headers, see
+    // Profile.cpp
+    bool includeProfile;
+    // Parse every translation unit in a child process so a crash in libclang
+    // takes down only that TU
+    bool isolate;
+    // Internal: this process is a child spawned by an isolated scan
+    bool worker;
+    // Internal: parse with the reduced flag set (retry attempt)
+    bool reduced;
+};
+
+enum struct ScanStatus {
+    Ok,
+    Retried,
+    Skipped,
+    Failed,
+};
+
+// Limits how many translation units are parsed at once so that the ASTs alive
+// at any moment fit into the memory budget. The per-TU cost is learned from
+// clang_getCXTUResourceUsage of finished parses: it rises immediately to the
+// largest TU seen and decays slowly, so one huge TU throttles the scan for a
+// while and then parallelism recovers.
+struct MemoryBudget {
+    std::mutex mutex;
+    std::condition_variable released;
+    u64 limit;
+    u64 estimate;
+    u32 inFlight;
+    u32 maxInFlight;
+    u32 waits;
+    bool warned;
+
+    u32 AllowedInFlight() {
+        if (limit == 0)
+            return UINT32_MAX;
+        // Probe with a single parse until there is a measurement
+        if (estimate == 0)
+            return 1;
+        return (u32)std::max<u64>(1, limit / estimate);
+    }
+
+    void Acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (inFlight >= AllowedInFlight()) {
+            waits++;
+            released.wait(lock, [this]() { return inFlight < AllowedInFlight(); });
+        }
+        inFlight++;
+        maxInFlight = std::max(maxInFlight, inFlight);
+    }
+
+    void Release(u64 measured, const std::string& input) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight--;
+            if (measured > estimate)
+                estimate = measured;
+            else
+                estimate = (estimate * 7 + measured) / 8;
+            if (limit && measured > limit && !warned) {
+                warned = true;
+                fprintf(stderr, "scan: %s: AST needs %llu MB, more than the whole memory budget; parsing one TU at a time\n",
+                        input.c_str(), (unsigned long long)(measured >> 20));
+            }
+        }
+        released.notify_all();
+    }
+};
+
+struct ScanStats {
+    std::atomic<u64> parsedTus;
+    std::atomic<u64> totalTuMemory;
+    std::atomic<u64> peakTuMemory;
+    std::atomic<u64> batches;
+    std::atomic<u64> batchFallbacks;
+    std::atomic<u64> typeLookups;
+    std::atomic<u64> typeHits;
+};
+
+// What a worker thread keeps across the TUs it scans
+struct ScanWorker {
+    CXIndex index;
+    CXIndexAction action;
+    TypeCache types;
+};
+
+struct ScanContext {
+    const ScanOptions* options;
+    std::vector<CXUnsavedFile> unsavedFiles;
+    MemoryBudget budget;
+    PreambleCache preambles;
+    ScanStats stats;
+    IncludeProfile profile;
+};
+
+u64 MeasureTranslationUnitMemory(CXTranslationUnit tu) {
+    CXTUResourceUsage usage = clang_getCXTUResourceUsage(tu);
+    u64 total = 0;
+    for (unsigned i = 0; i < usage.numEntries; i++)
+        total += usage.entries[i].amount;
+    clang_disposeCXTUResourceUsage(usage);
+    return total;
+}
+
+const char* ParseErrorString(CXErrorCode error) {
+    switch (error) {
+    case CXError_Success: return "success";
+    case CXError_Failure: return "failure";
+    case CXError_Crashed: return "libclang crashed";
+    case CXError_InvalidArguments: return "invalid arguments";
+    case CXError_ASTReadError: return "AST read error";
+    default: return "unknown error";
+    }
+}
+
+// Flags that change what the code means. Everything else (warnings, codegen
+// and plugin options, ...) is dropped when retrying a TU after a failure.
+static bool IsEssentialArg(const std::string& arg, bool* takesValue) {
+    static const char* prefixes[] = { "-I", "-D", "-U", "-x", "-include", "-isystem", "-iquote" };
+    *takesValue = false;
+    if (arg.compare(0, 5, "-std=") == 0 || arg.compare(0, 7, "--std=") == 0)
+        return true;
+    for (u32 i = 0; i < ArrayCount(prefixes); i++) {
+        size_t length = strlen(prefixes[i]);
+        if (arg.compare(0, length, prefixes[i]) == 0) {
+            *takesValue = arg.size() == length;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> ReducedClangArgs(const std::vector<std::string>& args) {
+    std::vector<std::string> result;
+    for (size_t i = 0; i < args.size(); i++) {
+        bool takesValue;
+        if (!IsEssentialArg(args[i], &takesValue))
+            continue;
+        result.push_back(args[i]);
+        if (takesValue && i + 1 < args.size())
+            result.push_back(args[++i]);
+    }
+    return result;
+}
+
+static void CollectInclusion(CXFile file, CXSourceLocation*, unsigned depth, CXClientData data) {
+    // The main file is an input, or a synthetic batch TU
+    if (depth == 0)
+        return;
+    Database* db = (Database*)data;
+    std::string path = AbsolutePath(ToString(clang_getFileName(file)));
+    if (db->dependencySet.insert(path).second)
+        db->dependencies.push_back(path);
+}
+
+// Parses a TU and extracts the declarations of the target files from it.
+// extraFile is an additional unsaved file for this parse only, such as a
+// synthetic batch TU. pchPath is a shared preamble to load. The TU is handed
+// back for the caller to check and dispose.
+CXErrorCode ParseAndExtract(ScanContext* context, ScanWorker* worker, const std::string& input, bool reduced, const ExtractTarget* targets, size_t targetCount,
+                            CXTranslationUnit* tu, const CXUnsavedFile* extraFile = 0, const char* pchPath = 0) {
+    const ScanOptions& options = *context->options;
+    std::vector<std::string> args = reduced ? ReducedClangArgs(options.clangArgs) : options.clangArgs;
+    std::vector<const char*> argv;
+    for (const std::string& arg : args)
+        argv.push_back(arg.c_str());
+    if (pchPath) {
+        argv.push_back("-include-pch");
+        argv.push_back(pchPath);
+    }
+    unsigned flags = reduced ? CXTranslationUnit_None : CXTranslationUnit_KeepGoing;
+    std::vector<CXUnsavedFile> unsavedFiles = context->unsavedFiles;
+    if (extraFile)
+        unsavedFiles.push_back(*extraFile);
+
+    // Indexing with unsaved files crashes in some libclang releases, TUs that
+    // need them always take the cursor walk
+    f64 startTime = GetTimeSeconds();
+    CXErrorCode error;
+    if (options.indexBackend && unsavedFiles.empty()) {
+        error = IndexTranslationUnit(worker->action, &worker->types, input.c_str(), argv.data(), (int)argv.size(), unsavedFiles.data(),
+                                     (unsigned)unsavedFiles.size(), flags, targets, targetCount, tu);
+    } else {
+        *tu = 0;
+        error = clang_parseTranslationUnit2(worker->index, input.c_str(), argv.data(), (int)argv.size(),
+                                            unsavedFiles.data(), (unsigned)unsavedFiles.size(), flags, tu);
+        if (error == CXError_Success && *tu)
+            ExtractTranslationUnit(*tu, &worker->types, targets, targetCount);
+    }
+    // A batch's dependencies all go to its first member, they are only used
+    // merged
+    if (error == CXError_Success && *tu) {
+        clang_getInclusions(*tu, CollectInclusion, targets[0].db);
+        if (options.includeProfile)
+            RecordIncludeProfile(&context->profile, *tu, GetTimeSeconds() - startTime, MeasureTranslationUnitMemory(*tu));
+    }
+    return error;
+}
+
+// The AST is disposed as soon as extraction is done; nothing else in the scan
+// holds on to a translation unit.
+void DisposeTranslationUnit(ScanContext* context, CXTranslationUnit tu, const std::string& input) {
+    u64 memory = MeasureTranslationUnitMemory(tu);
+    clang_disposeTranslationUnit(tu);
+    context->budget.Release(memory, input);
+
+    ScanStats* stats = &context->stats;
+    stats->parsedTus++;
+    stats->totalTuMemory += memory;
+    u64 peak = stats->peakTuMemory;
+    while (memory > peak && !stats->peakTuMemory.compare_exchange_weak(peak, memory)) {}
+}
+
+static bool HasFatalDiagnostic(CXTranslationUnit tu) {
+    bool fatal = false;
+    unsigned count = clang_getNumDiagnostics(tu);
+    for (unsigned i = 0; i < count && !fatal; i++) {
+        CXDiagnostic diagnostic = clang_getDiagnostic(tu, i);
+        fatal = clang_getDiagnosticSeverity(diagnostic) == CXDiagnostic_Fatal;
+        clang_disposeDiagnostic(diagnostic);
+    }
+    return fatal;
+}
+
+static bool ScanOnce(ScanContext* context, ScanWorker* worker, const std::string& input, bool reduced, Database* db) {
+    const ScanOptions& options = *context->options;
+    context->budget.Acquire();
+    const char* pchPath = 0;
+    if (options.sharePreamble && !reduced)
+        pchPath = AcquirePreamble(&context->preambles, worker->index, input, options.clangArgs, context->unsavedFiles);
+    ExtractTarget target = { input, db };
+    CXTranslationUnit tu;
+    CXErrorCode error = ParseAndExtract(context, worker, input, reduced, &target, 1, &tu, 0, pchPath);
+    if (pchPath && (error != CXError_Success || !tu || HasFatalDiagnostic(tu))) {
+        fprintf(stderr, "scan: %s: shared preamble %s is unusable, parsing without it\n", input.c_str(), pchPath);
+        if (tu)
+            clang_disposeTranslationUnit(tu);
+        RejectPreamble(&context->preambles, input);
+        *db = Database();
+        error = ParseAndExtract(context, worker, input, reduced, &target, 1, &tu);
+    }
+    if (error != CXError_Success || !tu) {
+        if (tu)
+            clang_disposeTranslationUnit(tu);
+        context->budget.Release(0, input);
+        fprintf(stderr, "scan: %s: parse failed: %s%s\n", input.c_str(), ParseErrorString(error), reduced ? "" : ", retrying with reduced flags");
+        return false;
+    }
+    DisposeTranslationUnit(context, tu, input);
+    return true;
+}
+
+ScanStatus ScanInProcess(ScanContext* context, ScanWorker* worker, const std::string& input, Database* db) {
+    if (ScanOnce(context, worker, input, false, db))
+        return ScanStatus::Ok;
+    *db = Database();
+    if (ScanOnce(context, worker, input, true, db))
+        return ScanStatus::Retried;
+    return ScanStatus::Failed;
+}
+
+static bool ScanInChild(const ScanOptions& options, const std::string& buffersPath, const std::string& input, u32 inputIndex, bool reduced, Database* db) {
+    std::string resultPath = MakeTempPath("scan-worker", inputIndex);
+    std::vector<std::string> args;
+    args.push_back(options.executablePath);
+    args.push_back("--worker");
+    if (reduced)
+        args.push_back("--reduced");
+    if (options.indexBackend) {
+        args.push_back("--backend");
+        args.push_back("index");
+    }
+    if (!buffersPath.empty()) {
+        args.push_back("--buffers");
+        args.push_back(buffersPath);
+    }
+    args.push_back("-o");
+    args.push_back(resultPath);
+    args.push_back(input);
+    args.push_back("--");
+    args.insert(args.end(), options.clangArgs.begin(), options.clangArgs.end());
+
+    ProcessResult process = RunProcess(args);
+    bool ok = false;
+    if (!process.started) {
+        fprintf(stderr, "scan: %s: failed to start worker process\n", input.c_str());
+    } else if (process.crashed) {
+        fprintf(stderr, "scan: %s: worker crashed (code %d)%s\n", input.c_str(), process.exitCode, reduced ? "" : ", retrying with reduced flags");
+    } else if (process.exitCode == 0) {
+        ok = ReadDatabase(resultPath.c_str(), db, true);
+        if (!ok)
+            fprintf(stderr, "scan: %s: failed to read worker result\n", input.c_str());
+    }
+    RemoveFile(resultPath.c_str());
+    return ok;
+}
+
+ScanStatus ScanIsolated(const ScanOptions& options, const std::string& buffersPath, const std::string& input, u32 inputIndex, Database* db) {
+    if (ScanInChild(options, buffersPath, input, inputIndex, false, db))
+        return ScanStatus::Ok;
+    *db = Database();
+    if (ScanInChild(options, buffersPath, input, inputIndex, true, db))
+        return ScanStatus::Retried;
+    return ScanStatus::Failed;
+}
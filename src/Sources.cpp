@@ -0,0 +1,117 @@
+// In-memory sources. Buffers are handed to libclang as CXUnsavedFile so
+// generated or unsaved code is scanned without touching the disk, and virtual
+// paths are mapped onto real files with a VFS overlay passed to clang.
+//
+// Buffer streams (--stdin, --buffers) are a sequence of records:
+//     <byte count> <path>\n<contents>
+
+struct SourceBuffer {
+    std::string path;
+    std::string contents;
+};
+
+struct FileMapping {
+    std::string virtualPath;
+    std::string realPath;
+};
+
+std::string AbsolutePath(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    return error ? path : absolute.lexically_normal().string();
+}
+
+bool ReadSourceBuffers(FILE* in, std::vector<SourceBuffer>* buffers) {
+    for (;;) {
+        unsigned long long size;
+        int read = fscanf(in, "%llu ", &size);
+        if (read == EOF)
+            return true;
+        if (read != 1)
+            return false;
+        SourceBuffer buffer;
+        int c;
+        while ((c = fgetc(in)) != EOF && c != '\n')
+            buffer.path.push_back((char)c);
+        if (c == EOF || buffer.path.empty())
+            return false;
+        buffer.contents.resize((size_t)size);
+        if (size && fread(&buffer.contents[0], (size_t)size, 1, in) != 1)
+            return false;
+        buffer.path = AbsolutePath(buffer.path);
+        buffers->push_back(std::move(buffer));
+    }
+}
+
+bool ReadSourceBuffersFile(const char* path, std::vector<SourceBuffer>* buffers) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    bool ok = ReadSourceBuffers(file, buffers);
+    fclose(file);
+    return ok;
+}
+
+bool WriteSourceBuffersFile(const char* path, const std::vector<SourceBuffer>& buffers) {
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    for (const SourceBuffer& buffer : buffers) {
+        fprintf(file, "%llu %s\n", (unsigned long long)buffer.contents.size(), buffer.path.c_str());
+        fwrite(buffer.contents.data(), buffer.contents.size(), 1, file);
+    }
+    return fclose(file) == 0;
+}
+
+std::vector<CXUnsavedFile> MakeUnsavedFiles(const std::vector<SourceBuffer>& buffers) {
+    std::vector<CXUnsavedFile> files(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        files[i].Filename = buffers[i].path.c_str();
+        files[i].Contents = buffers[i].contents.data();
+        files[i].Length = (unsigned long)buffers[i].contents.size();
+    }
+    return files;
+}
+
+bool WriteVirtualFileOverlay(const char* path, const std::vector<FileMapping>& mappings) {
+    CXVirtualFileOverlay overlay = clang_VirtualFileOverlay_create(0);
+    bool ok = true;
+    for (const FileMapping& mapping : mappings) {
+        std::string virtualPath = AbsolutePath(mapping.virtualPath);
+        std::string realPath = AbsolutePath(mapping.realPath);
+        if (clang_VirtualFileOverlay_addFileMapping(overlay, virtualPath.c_str(), realPath.c_str()) != CXError_Success) {
+            fprintf(stderr, "scan: invalid file mapping %s=%s\n", mapping.virtualPath.c_str(), mapping.realPath.c_str());
+            ok = false;
+        }
+    }
+    char* yaml = 0;
+    unsigned size = 0;
+    if (ok)
+        ok = clang_VirtualFileOverlay_writeToBuffer(overlay, 0, &yaml, &size) == CXError_Success;
+    if (ok)
+        ok = WriteEntireFile(path, yaml, size);
+    if (yaml)
+        clang_free(yaml);
+    clang_VirtualFileOverlay_dispose(overlay);
+    return ok;
+}
+
+// Contents of a source as clang sees them: a buffer if there is one, the file otherwise
+bool LoadSource(const std::vector<SourceBuffer>& buffers, const std::string& path, std::string* source) {
+    std::string absolute = AbsolutePath(path);
+    for (const SourceBuffer& buffer : buffers) {
+        if (buffer.path == absolute) {
+            *source = buffer.contents;
+            return true;
+        }
+    }
+    std::vector<u8> bytes;
+    if (!ReadEntireFile(path.c_str(), &bytes))
+        return false;
+    source->assign(bytes.begin(), bytes.end());
+    return true;
+}
+
+static bool IsIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
@@ -0,0 +1,22 @@
+@echo off
+
+rem Scans the headers in test\ and compiles what scan generates for them, runs
+rem test\Main.cpp over the code generated for test\Sample.h, and builds the
+rem field access benchmark in build\test\bench.exe. Run build.bat first.
+
+set OutDir=build\test\
+
+IF NOT EXIST %OutDir% mkdir %OutDir%
+
+build\scan.exe --generate %OutDir%Generated.cpp test\Methods.h -- -x c++ -std=c++17 -Iinclude || exit /b 1
+cl /nologo /W3 /WX /EHsc /std:c++17 /Iinclude /c /Fo%OutDir% %OutDir%Generated.cpp || exit /b 1
+findstr /C:"\"test::Methods::Local\"" %OutDir%Generated.cpp >NUL || (echo test: no thunk for test::Methods::Local & exit /b 1)
+
+build\scan.exe --generate %OutDir%SampleGenerated.cpp --generate-header %OutDir%SampleReflect.h test\Sample.h -- -x c++ -std=c++17 -Iinclude || exit /b 1
+cl /nologo /W3 /WX /EHsc /std:c++17 /Iinclude /I%OutDir% /Fo%OutDir% /Fe%OutDir%sample.exe test\Main.cpp %OutDir%SampleGenerated.cpp || exit /b 1
+%OutDir%sample.exe || exit /b 1
+
+build\scan.exe --generate %OutDir%BenchGenerated.cpp --generate-header %OutDir%BenchReflect.h test\Bench.h -- -x c++ -std=c++17 -Iinclude || exit /b 1
+cl /nologo /W3 /WX /EHsc /std:c++17 /O2 /Iinclude /I%OutDir% /Fo%OutDir% /Fe%OutDir%bench.exe test\Bench.cpp %OutDir%BenchGenerated.cpp || exit /b 1
+
+echo test: OK
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Scans the headers in test/ and compiles what scan generates for them, runs
+# test/Main.cpp over the code generated for test/Sample.h, and builds the
+# field access benchmark in build/test/bench. Pass the scan binary in SCAN,
+# extra clang arguments (system include paths) in CLANG_ARGS, and the compiler
+# in CXX.
+set -e
+cd "$(dirname "$0")"
+SCAN=${SCAN:-build/scan}
+OUT=build/test
+mkdir -p $OUT
+"$SCAN" --generate $OUT/Generated.cpp test/Methods.h -- -x c++ -std=c++17 -Iinclude $CLANG_ARGS
+${CXX:-c++} -std=c++17 -Wall -Iinclude -c $OUT/Generated.cpp -o $OUT/Generated.o
+grep -q '"test::Methods::Local"' $OUT/Generated.cpp || { echo "test: no thunk for test::Methods::Local"; exit 1; }
+"$SCAN" --generate $OUT/SampleGenerated.cpp --generate-header $OUT/SampleReflect.h test/Sample.h -- -x c++ -std=c++17 -Iinclude $CLANG_ARGS
+${CXX:-c++} -std=c++17 -Wall -Iinclude -I$OUT test/Main.cpp $OUT/SampleGenerated.cpp -o $OUT/sample
+$OUT/sample
+"$SCAN" --generate $OUT/BenchGenerated.cpp --generate-header $OUT/BenchReflect.h test/Bench.h -- -x c++ -std=c++17 -Iinclude $CLANG_ARGS
+${CXX:-c++} -std=c++17 -O2 -Wall -Iinclude -I$OUT test/Bench.cpp $OUT/BenchGenerated.cpp -o $OUT/bench
+echo "test: OK"
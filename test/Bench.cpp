@@ -0,0 +1,90 @@
+// Field access by name against direct access: a field_handle that hits its
+// cache, one that misses on every access because the type alternates, and
+// the registry lookup a miss makes, for the first and the last of a type's
+// 32 fields. The lookup is set against a linear scan of the fields' name
+// hashes, which costs more the further the field is. test.sh and test.bat
+// build it, it is run by hand:
+//
+//     build/test/bench [iterations]
+
+#include <chrono>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <prx/Access.h>
+
+#include "BenchReflect.h"
+
+using namespace bench;
+
+static const size_t object_count = 1024;
+
+static Small smalls[object_count];
+static Wide wides[object_count];
+// Smalls and wides by turns
+static void* mixed[object_count];
+static prx::type_id mixed_ids[object_count];
+
+// Keeps the compiler from moving a lookup out of the loop
+template <typename T> static T opaque(T value) {
+    volatile T copy = value;
+    return copy;
+}
+
+template <typename Access> static void measure(const char* label, size_t iterations, Access&& access) {
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for (size_t i = 0; i < iterations; i++)
+        sum += access(i & (object_count - 1));
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%-28s %6.2f ns/access (%lld)\n", label, ns / (double)iterations, sum);
+}
+
+// What registry::find_field did before it had a perfect hash
+static const prx::field_record* find_field_linear(const prx::registry& types, prx::type_id id, const char* name) {
+    size_t size = strlen(name);
+    uint64_t hash = prx::hash_name(name, size);
+    for (const prx::field_record& field : types.fields(id)) {
+        const char* field_name = types.field_strings(field).name;
+        if (field.name_hash == hash && strncmp(field_name, name, size) == 0 && field_name[size] == 0)
+            return &field;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? (size_t)strtoull(argv[1], 0, 10) : 10000000;
+    const prx::registry& types = prx::registry::generated();
+    prx::type_id small_id = prx::reflect<Small>::id;
+    prx::type_id wide_id = prx::reflect<Wide>::id;
+    for (size_t i = 0; i < object_count; i++) {
+        smalls[i].health = (int)i;
+        wides[i].health = (int)i;
+        mixed[i] = i % 2 ? (void*)&smalls[i] : (void*)&wides[i];
+        mixed_ids[i] = i % 2 ? small_id : wide_id;
+    }
+
+    // Every lookup finds the field the compiler puts there
+    const Wide& wide = wides[0];
+    if (PRX_FIELD("health").get(wides[1]) != &wides[1].health || PRX_FIELD("health").get(wide) != &wide.health ||
+        PRX_FIELD("health").get(smalls[1]) != &smalls[1].health || PRX_FIELD("missing").get(wides[1]) ||
+        types.find_field(wide_id, "f0")->offset != offsetof(Wide, f0) || types.find_field(wide_id, "f17")->offset != offsetof(Wide, f17) ||
+        types.find_field(wide_id, "health")->offset != offsetof(Wide, health) || types.find_field(wide_id, "speed") ||
+        types.find_field(small_id, "speed")->offset != offsetof(Small, speed) || types.find_field(small_id, "f0")) {
+        fprintf(stderr, "bench: a lookup found the wrong field\n");
+        return 1;
+    }
+
+    measure("direct", iterations, [&](size_t i) { return wides[i].health; });
+    measure("field_handle, cached", iterations, [&](size_t i) { return *(int*)PRX_FIELD("health").get(wide_id, &wides[i]); });
+    measure("field_handle, type changes", iterations, [&](size_t i) { return *(int*)PRX_FIELD("health").get(mixed_ids[i], mixed[i]); });
+    measure("find_field, first field", iterations, [&](size_t i) { return (int)types.find_field(wide_id, opaque("f0"))->offset + (int)i; });
+    measure("find_field, last field", iterations, [&](size_t i) { return (int)types.find_field(wide_id, opaque("health"))->offset + (int)i; });
+    measure("linear scan, first field", iterations,
+            [&](size_t i) { return (int)find_field_linear(types, wide_id, opaque("f0"))->offset + (int)i; });
+    measure("linear scan, last field", iterations,
+            [&](size_t i) { return (int)find_field_linear(types, wide_id, opaque("health"))->offset + (int)i; });
+    return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Types for test/Bench.cpp: a small one and one with many fields, the field
+// it reads last
+
+#include <prx/Annotations.h>
+
+namespace bench {
+
+struct PRX_REFLECT Small {
+    float speed;
+    int health;
+};
+
+struct PRX_REFLECT Wide {
+    int f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15;
+    int f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30;
+    int health;
+};
+
+} // namespace bench
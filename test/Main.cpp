@@ -0,0 +1,271 @@
+// Runs the code scan generates for test/Sample.h: the registry tables, the
+// reflect specializations, JSON, hashing, soa_vector and tracked, and the
+// runtime headers built on them. test.sh and test.bat build and run it.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <prx/Access.h>
+#include <prx/Any.h>
+#include <prx/Hash.h>
+#include <prx/Json.h>
+#include <prx/Pool.h>
+#include <prx/Registry.h>
+
+#include "SampleReflect.h"
+
+using namespace sample;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+static size_t offset_in(const void* object, const void* field) {
+    return (size_t)(static_cast<const char*>(field) - static_cast<const char*>(object));
+}
+
+static void test_registry() {
+    const prx::registry& types = prx::registry::generated();
+    prx::type_id player = types.find("sample::Player");
+    prx::type_id entity = types.find("sample::Entity");
+    prx::type_id vec3 = types.find("sample::Vec3");
+    CHECK(player == prx::reflect<Player>::id);
+    CHECK(entity == prx::reflect<Entity>::id);
+    CHECK(vec3 == prx::reflect<Vec3>::id);
+    CHECK(types.find("sample::Missing") == prx::invalid_type_id);
+    CHECK(strcmp(types.type_name(player), "sample::Player") == 0);
+
+    const prx::type_record& record = types.type(player);
+    CHECK(record.size == sizeof(Player));
+    CHECK(record.align == alignof(Player));
+    CHECK(record.flags & prx::type_polymorphic);
+    CHECK(!(record.flags & prx::type_trivially_copyable));
+    CHECK(types.type(types.find("sample::Team")).flags & prx::type_enum);
+    CHECK(types.bases(player).size() == 1 && types.bases(player)[0] == entity);
+
+    // Own fields only, bases aren't searched
+    Player object;
+    CHECK(types.fields(player).size() == 3);
+    const prx::field_record* health = types.find_field(player, "health");
+    CHECK(health && health->offset == offset_in(&object, &object.health) && health->size == sizeof(int));
+    CHECK(health && strcmp(types.field_strings(*health).name, "health") == 0);
+    const prx::field_record* velocity = types.find_field(player, "velocity");
+    CHECK(velocity && velocity->type == vec3);
+    const prx::field_record* name = types.find_field(player, "name");
+    CHECK(name && name->type == prx::invalid_type_id);
+    CHECK(!types.find_field(player, "id"));
+    CHECK(!types.find_field(player, "healt"));
+    CHECK(types.find_field(entity, "position") && types.find_field(entity, "position")->type == vec3);
+}
+
+static void test_reflect() {
+    Player player;
+    std::vector<std::string> names;
+    bool offsets = true;
+    prx::for_each_field(player, [&](const auto& field, auto& value) {
+        names.push_back(field.name);
+        offsets = offsets && offset_in(&player, &value) == field.offset;
+    });
+    CHECK((names == std::vector<std::string>{ "id", "position", "health", "name", "velocity" }));
+    CHECK(offsets);
+    CHECK(prx::reflect<Player>::field_count == 3);
+    CHECK(strcmp(prx::reflect<Vec3>::name, "sample::Vec3") == 0);
+}
+
+static void test_access() {
+    Player player;
+    const Player& constant = player;
+    Vec3 vec;
+    CHECK(PRX_FIELD("health").get(prx::reflect<Player>::id, &player) == &player.health);
+    CHECK(PRX_FIELD("health").get(player) == &player.health);
+    CHECK(PRX_FIELD("health").get(constant) == &player.health);
+    CHECK(PRX_FIELD("health").get(vec) == 0);
+    prx::field_handle y("y");
+    CHECK(y.get(vec) == &vec.y && y.field_type() == prx::invalid_type_id);
+    CHECK(y.get(player) == 0);
+    CHECK(y.get(vec) == &vec.y);
+}
+
+static void test_pools() {
+    prx::pool_set pools;
+    Player* player = pools.create<Player>();
+    CHECK(player && player->health == 100 && player->name.empty());
+    player->name = std::string(64, 'p');
+
+    prx::type_id vec3 = prx::reflect<Vec3>::id;
+    void* vecs[100];
+    CHECK(pools.create(vec3, vecs, 100));
+    for (void* it : vecs)
+        static_cast<Vec3*>(it)->x = 1;
+    pools.destroy(vec3, vecs, 50);
+
+    std::vector<prx::pool_stats> stats = pools.stats();
+    CHECK(stats.size() == 2);
+    for (const prx::pool_stats& it : stats) {
+        if (it.type == vec3)
+            CHECK(it.live == 50 && it.live_bytes == 50 * sizeof(Vec3));
+        else
+            CHECK(it.type == prx::reflect<Player>::id && it.live == 1);
+    }
+    pools.destroy(vec3, vecs + 50, 50);
+    pools.destroy(player);
+    for (const prx::pool_stats& it : pools.stats())
+        CHECK(it.live == 0);
+}
+
+static void test_any() {
+    Player player;
+    player.health = 7;
+    player.name = std::string(64, 'n');
+    prx::any a = player;
+    CHECK(!a.is_inline() && a.get<Player>() && a.get<Player>()->health == 7);
+    prx::any b = a;
+    CHECK(b.get<Player>() && b.get<Player>()->name == player.name && b.data() != a.data());
+    prx::any c = std::move(b);
+    CHECK(b.empty() && c.get<Player>() && c.get<Player>()->name == player.name);
+
+    Vec3 vec = { 1, 2, 3 };
+    prx::any d = vec;
+    CHECK(d.is_inline() && d.get<Vec3>() && d.get<Vec3>()->z == 3 && !d.get<Player>());
+    prx::any e = std::move(d);
+    CHECK(d.empty() && e.get<Vec3>() && e.get<Vec3>()->y == 2);
+    e = c;
+    CHECK(e.type() == prx::reflect<Player>::id && e.get<Player>()->health == 7);
+
+    const prx::registry& types = prx::registry::generated();
+    prx::any blank(types.find("sample::Player"));
+    CHECK(blank.get<Player>() && blank.get<Player>()->health == 100);
+    prx::any copy(prx::reflect<Vec3>::id, &vec);
+    CHECK(copy.get<Vec3>() && copy.get<Vec3>()->x == 1);
+    copy.reset();
+    CHECK(copy.empty() && copy.type() == prx::invalid_type_id);
+}
+
+static void test_json() {
+    Loadout loadout;
+    loadout.primary = Weapon::Staff;
+    loadout.secondary = Weapon::Bow;
+    loadout.slot1 = 1;
+    loadout.slot2 = -2;
+    loadout.slot3 = 3;
+    loadout.weight = 2.5;
+    loadout.owner = "a \"quoted\"\nname";
+    loadout.charms = { 4, 5 };
+    std::string text;
+    prx::to_json(loadout, &text);
+    CHECK(text.find("\"primary\":\"Staff\"") != std::string::npos);
+
+    Loadout back;
+    CHECK(prx::from_json(text.data(), text.size(), &back));
+    CHECK(back.primary == Weapon::Staff && back.secondary == Weapon::Bow);
+    CHECK(back.slot1 == 1 && back.slot2 == -2 && back.slot3 == 3);
+    CHECK(back.weight == 2.5 && back.owner == loadout.owner && back.charms == loadout.charms);
+
+    // Keys of one length told apart by one character, in any order, unknown
+    // keys skipped, missing ones left alone, enums by number too
+    const char input[] = " { \"slot3\": 30, \"slotX\": [1, {\"a\": 2}], \"slot1\": 10, \"owner\": \"o\", \"secondary\": 1 } ";
+    Loadout partial;
+    partial.slot2 = 7;
+    CHECK(prx::from_json(input, sizeof(input) - 1, &partial));
+    CHECK(partial.slot1 == 10 && partial.slot2 == 7 && partial.slot3 == 30 && partial.owner == "o");
+    CHECK(partial.primary == Weapon::Sword && partial.secondary == Weapon::Bow);
+
+    Weapon weapon = Weapon::Sword;
+    CHECK(prx::from_json("\"Bow\"", 5, &weapon) && weapon == Weapon::Bow);
+    CHECK(!prx::from_json("\"Swore\"", 7, &weapon));
+    CHECK(!prx::from_json("{\"slot1\": 1", 11, &partial));
+}
+
+static void test_hash() {
+    prx::hash<GridKey> grid_hash;
+    prx::equal_to<GridKey> grid_equal;
+    GridKey a = { 1, -2, 3, 4 };
+    GridKey b = a;
+    CHECK(grid_equal(a, b) && grid_hash(a) == grid_hash(b));
+    b.lod = 5;
+    CHECK(!grid_equal(a, b) && grid_hash(a) != grid_hash(b));
+
+    prx::hash<AssetKey> asset_hash;
+    prx::equal_to<AssetKey> asset_equal;
+    AssetKey c = { 1, "textures/stone.png", 7 };
+    AssetKey d = { 1, std::string("textures/") + "stone.png", 7 };
+    CHECK(c.path.data() != d.path.data());
+    CHECK(asset_equal(c, d) && asset_hash(c) == asset_hash(d));
+    d.path = "textures/stone.jpg";
+    CHECK(!asset_equal(c, d) && asset_hash(c) != asset_hash(d));
+    d.path = c.path;
+    d.version = 8;
+    CHECK(!asset_equal(c, d) && asset_hash(c) != asset_hash(d));
+    d.version = 7;
+    d.kind = 2;
+    CHECK(!asset_equal(c, d) && asset_hash(c) != asset_hash(d));
+}
+
+static void test_soa() {
+    prx::soa_vector<Particle> particles;
+    for (int i = 0; i < 100; i++)
+        particles.push_back({ (float)i, (float)-i, 1, 2 });
+    CHECK(particles.size() == 100);
+    for (auto p : particles)
+        p.x += p.vx;
+    CHECK(particles[10].x == 11 && particles[10].y == -10 && particles[10].vy == 2);
+    particles[10] = Particle{ 5, 6, 7, 8 };
+    Particle copy = particles[10];
+    CHECK(copy.x == 5 && copy.y == 6 && copy.vx == 7 && copy.vy == 8);
+    CHECK(particles.x().data()[99] == 100 && particles.y().size() == 100);
+    CHECK((size_t)particles.vx().data() % prx::soa_vector<Particle>::column_alignment == 0);
+}
+
+static void test_delta() {
+    prx::tracked<Avatar> local;
+    prx::tracked<Avatar> remote;
+    local.set_name("archer");
+    local.mutate_items().push_back(3);
+
+    // The first delta is a full update
+    prx::delta_writer full;
+    local.write_delta(full);
+    local.clear_dirty();
+    prx::delta_reader in(full.bytes.data(), full.bytes.size());
+    CHECK(remote.apply_delta(in) && in.at == in.end);
+    CHECK(remote.health() == 100 && remote.name() == "archer" && remote.items() == local.items());
+
+    // Then only what changed
+    local.set_health(42);
+    local.mutate_items().push_back(9);
+    prx::delta_writer update;
+    local.write_delta(update);
+    CHECK(update.bytes.size() < full.bytes.size());
+    prx::delta_reader in2(update.bytes.data(), update.bytes.size());
+    CHECK(remote.apply_delta(in2) && in2.at == in2.end);
+    CHECK(remote.health() == 42 && remote.speed() == 1 && remote.name() == "archer");
+    CHECK(remote.items().size() == 2 && remote.items()[1] == 9);
+
+    prx::delta_reader truncated(update.bytes.data(), update.bytes.size() - 1);
+    CHECK(!remote.apply_delta(truncated));
+}
+
+int main() {
+    test_registry();
+    test_reflect();
+    test_access();
+    test_pools();
+    test_any();
+    test_json();
+    test_hash();
+    test_soa();
+    test_delta();
+    if (failures) {
+        fprintf(stderr, "sample: %d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Methods the generated invoke thunks have to skip or call in a particular
+// way
+
+#include <prx/Annotations.h>
+
+namespace test {
+
+struct PRX_REFLECT Methods {
+    int value;
+
+    int Get() const { return value; }
+    // No thunk, it can't be called
+    void Deleted() = delete;
+    // Called on the object cast to an rvalue
+    int Consume() && { return value; }
+    int Peek() const&& { return value; }
+    int Borrow() & { return value; }
+    static int Twice(int x) { return 2 * x; }
+    // A body is never searched for "= delete"
+    int Local() const {
+        struct Guard {
+            Guard(const Guard&) = delete;
+        };
+        return value;
+    }
+    void Commented() /* gone */ = /* for good */ delete;
+};
+
+PRX_REFLECT void Removed(int) = delete;
+
+} // namespace test
@@ -0,0 +1,80 @@
+#pragma once
+
+// Reflected types for test/Main.cpp: one small enough for an any's buffer,
+// one too large for it with a base and a field of a type the registry
+// doesn't know, and an enum. Then a type for each generated feature: JSON,
+// hashing both ways, struct-of-arrays storage and delta replication.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <prx/Annotations.h>
+
+namespace sample {
+
+struct PRX_REFLECT Vec3 {
+    float x;
+    float y;
+    float z;
+};
+
+struct PRX_REFLECT Entity {
+    unsigned id;
+    Vec3 position;
+
+    virtual ~Entity() {}
+};
+
+struct PRX_REFLECT Player : Entity {
+    int health = 100;
+    std::string name;
+    Vec3 velocity;
+};
+
+enum class PRX_REFLECT Team { Red, Blue };
+
+enum class PRX_REFLECT PRX_JSON Weapon { Sword, Bow, Staff };
+
+// Keys of one length that differ in a single character
+struct PRX_REFLECT PRX_JSON Loadout {
+    Weapon primary = Weapon::Sword;
+    Weapon secondary = Weapon::Sword;
+    int slot1 = 0;
+    int slot2 = 0;
+    int slot3 = 0;
+    double weight = 0;
+    std::string owner;
+    std::vector<int> charms;
+};
+
+// No padding and integers only: one memcmp
+struct PRX_REFLECT PRX_HASH GridKey {
+    int32_t x;
+    int32_t y;
+    uint32_t layer;
+    uint32_t lod;
+};
+
+// A string in the middle: compared field by field
+struct PRX_REFLECT PRX_HASH AssetKey {
+    uint32_t kind;
+    std::string path;
+    uint64_t version;
+};
+
+struct PRX_REFLECT PRX_SOA Particle {
+    float x;
+    float y;
+    float vx;
+    float vy;
+};
+
+struct PRX_REFLECT PRX_REPLICATE Avatar {
+    int health = 100;
+    float speed = 1;
+    std::string name;
+    std::vector<uint32_t> items;
+};
+
+} // namespace sample